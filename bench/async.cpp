@@ -0,0 +1,67 @@
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include "./common.hpp"
+#include "../src/renderer.hpp"
+
+using namespace std;
+
+// benchmark of the background render jobs, measures the
+// time from cancelling a job until its workers stopped for
+// tiles of different sizes and runs a low priority job that
+// is preempted by an urgent one
+
+// size of the images
+const size_t n_pixels = 128;
+
+int main(void) {
+    // the scene of the main program
+    Camera cam = cornell_camera();
+    unique_ptr<Scene> cornell = cornell_scene();
+    const Scene& scene = *cornell;
+    // cancel jobs after a fixed time, the latency
+    // does not depend on the size of the tiles as
+    // the workers stop after their current bounce
+    cout << "cancellation latency:" << endl;
+    for (const int& tile_size : { 8, 32, 128 }) {
+        Renderer renderer(scene, cam, 64, 10);
+        renderer.regeneration(true);
+        renderer.tile_size(tile_size);
+        FrameBuffer fb(n_pixels, n_pixels);
+        unique_ptr<RenderJob> job = renderer.render_async(fb);
+        this_thread::sleep_for(chrono::milliseconds(200));
+        float progress = job->progress();
+        auto start = chrono::steady_clock::now();
+        job->cancel();
+        job->wait();
+        double latency = seconds_since(start);
+        FrameBuffer partial(n_pixels, n_pixels);
+        size_t n_tiles = job->partial(partial);
+        cout << "  " << tile_size << "x" << tile_size << " tiles: stopped after " << latency * 1e3 << "ms at "
+             << 100.0f * progress << "% with " << n_tiles << " tiles written" << endl;
+    }
+    // a low priority job is preempted by an urgent one
+    // and restarted once the urgent job is done
+    Renderer background(scene, cam, 16, 10), urgent(scene, cam, 4, 10);
+    background.regeneration(true);
+    urgent.regeneration(true);
+    FrameBuffer fb_background(n_pixels, n_pixels), fb_urgent(n_pixels, n_pixels);
+    auto start = chrono::steady_clock::now();
+    unique_ptr<RenderJob> job = background.render_async(fb_background);
+    this_thread::sleep_for(chrono::milliseconds(100));
+    job->cancel();
+    job->wait();
+    double t_preempt = seconds_since(start);
+    urgent.render(fb_urgent);
+    double t_urgent = seconds_since(start);
+    job = background.render_async(fb_background);
+    // report the progress of the restarted job
+    while (!job->done()) {
+        this_thread::sleep_for(chrono::milliseconds(250));
+        cout << "  background job at " << 100.0f * job->progress() << "%" << endl;
+    }
+    cout << "preempted after " << t_preempt * 1e3 << "ms, urgent job done after " << t_urgent * 1e3
+         << "ms, background job done after " << seconds_since(start) * 1e3 << "ms" << endl;
+}
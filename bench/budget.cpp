@@ -0,0 +1,42 @@
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include "./common.hpp"
+#include "../src/renderer.hpp"
+
+using namespace std;
+
+// benchmark of renders with a time budget, reports how
+// close each call ends to its deadline, the samples per
+// pixel it reached and the rate of samples compared to a
+// single render with the same number of samples per pixel
+
+// size of the image
+const size_t n_pixels = 128;
+
+int main(void) {
+    // the scene of the main program
+    Camera cam = cornell_camera();
+    unique_ptr<Scene> cornell = cornell_scene();
+    const Scene& scene = *cornell;
+    Renderer renderer(scene, cam, 1, 10);
+    renderer.regeneration(true);
+    for (const double& budget : { 0.1, 0.25, 0.5, 1.0, 2.0 }) {
+        FrameBuffer fb(n_pixels, n_pixels);
+        BudgetedRender r = renderer.render(fb, budget);
+        cout << "  budget " << budget * 1e3 << "ms: took " << r.seconds * 1e3 << "ms, " << r.spp;
+        if (r.max_spp != r.spp) { cout << "-" << r.max_spp; }
+        cout << " spp in " << r.n_passes << " passes";
+        // the samples of all pixels per second against a
+        // render of the same samples in a single pass
+        FrameBuffer fixed(n_pixels, n_pixels);
+        Renderer reference(scene, cam, r.spp, 10);
+        reference.regeneration(true);
+        auto start = chrono::steady_clock::now();
+        reference.render(fixed);
+        double t_fixed = seconds_since(start);
+        cout << ", " << r.n_samples / r.seconds / 1e6 << "M samples/s (single pass "
+             << r.spp * n_pixels * n_pixels / t_fixed / 1e6 << "M samples/s)" << endl;
+    }
+}
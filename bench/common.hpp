@@ -0,0 +1,70 @@
+#ifndef H_BENCH_COMMON
+#define H_BENCH_COMMON
+
+// includes
+#include <chrono>
+#include <memory>
+#include "../src/vec.hpp"
+#include "../src/arena.hpp"
+#include "../src/camera.hpp"
+#include "../src/scene.hpp"
+#include "../src/mesh.hpp"
+#include "../src/texture.hpp"
+#include "../src/material.hpp"
+#include "../src/framebuffer.hpp"
+
+// helpers shared by the benchmarks
+
+// seconds passed since the given time point
+inline double seconds_since(const std::chrono::steady_clock::time_point& start) {
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count() / 1e6;
+}
+
+// number of differing bytes of two images
+inline size_t n_differ(const FrameBuffer& a, const FrameBuffer& b) {
+    size_t n = 0;
+    for (size_t i = 0; i < a.height(); i++) {
+        for (size_t j = 0; j < a.width(); j++) {
+            for (size_t c = 0; c < 3; c++) { n += a.pixel(i, j)[c] != b.pixel(i, j)[c]; }
+        }
+    }
+    return n;
+}
+
+// the camera of the main program looking
+// into the cornell box scaled by 20
+inline Camera cornell_camera(void) {
+    Camera cam(Vec3f(0.5, 0.5, 1.35) * 20, Vec3f(0, 0, -1), Vec3f(0, 1, 0));
+    cam.fov(40.0f);
+    cam.vp_dist(1.35f * 20 + 1e-3f);
+    return cam;
+}
+
+// the cornell box of the main program scaled by 20 holding up
+// to two pairs of a block and a sphere, the first pair is the
+// one of the main program with a glass sphere, the second one
+// has a smaller block and a mirror sphere
+inline std::unique_ptr<Scene> cornell_scene(const size_t& n_pairs = 1) {
+    Arena arena;
+    mtl::Material* light = arena.create<mtl::Light>(arena.create<txr::Constant>(Vec3f::ones * 3.0f));
+    mtl::Material* red = arena.create<mtl::Lambertian>(arena.create<txr::Constant>(Vec3f(0.25f, 0.25f, 0.75f)));
+    mtl::Material* blue = arena.create<mtl::Lambertian>(arena.create<txr::Constant>(Vec3f(0.75f, 0.25f, 0.25f)));
+    mtl::Material* white = arena.create<mtl::Lambertian>(arena.create<txr::Constant>(Vec3f(0.75f, 0.75f, 0.75f)));
+    mtl::Material* glass = arena.create<mtl::Dielectric>(arena.create<txr::Constant>(Vec3f(1.0f, 1.0f, 1.0f)), 1.5f);
+    mtl::Material* mirror = arena.create<mtl::Metallic>(arena.create<txr::Constant>(Vec3f(1.0f, 1.0f, 1.0f)), 0.0f);
+    Mesh cornell = Mesh::CornellBox(white, red, blue, light);
+    BoundableList objects;
+    if (n_pairs >= 1) {
+        cornell.extend(Mesh::Parallelepiped(Vec3f(0.25, 0, -0.5), Vec3f(0.15, 0, -0.8), Vec3f(0.55, 0, -0.6), Vec3f(0.25, 0.6, -0.5), white));
+        objects.push_back(arena.create<Sphere>(Vec3f(0.7, 0.45, -0.3) * 20, 0.15 * 20, glass));
+    }
+    if (n_pairs >= 2) {
+        cornell.extend(Mesh::Parallelepiped(Vec3f(0.8, 0, -0.15), Vec3f(0.5, 0, -0.25), Vec3f(0.9, 0, -0.45), Vec3f(0.8, 0.3, -0.15), white));
+        objects.push_back(arena.create<Sphere>(Vec3f(0.3, 0.15, -0.3) * 20, 0.15 * 20, mirror));
+    }
+    cornell.scale(20.0f);
+    return std::unique_ptr<Scene>(new Scene(cornell, objects, std::move(arena)));
+}
+
+#endif // H_BENCH_COMMON
@@ -0,0 +1,59 @@
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include "./common.hpp"
+#include "../src/renderer.hpp"
+#include "../src/context.hpp"
+
+using namespace std;
+
+// benchmark of many small frames rendered by renderers of
+// two scenes with different stream sizes, either starting
+// a new context for every frame or sharing a single one,
+// the frames of the shared context have to match the ones
+// rendered on fresh workers
+
+// number and size of the frames
+const size_t n_frames = 64;
+const size_t n_pixels = 48;
+
+int main(void) {
+    Camera cam = cornell_camera();
+    // the empty cornell box and the box with
+    // a sphere and a block in it
+    vector<unique_ptr<Scene>> scenes;
+    for (size_t k = 0; k < 2; k++) { scenes.push_back(cornell_scene(k)); }
+    // one renderer per scene with different
+    // numbers of paths traced at once
+    Renderer small(*scenes[0], cam, 4, 10), large(*scenes[1], cam, 4, 10);
+    small.regeneration(true);
+    large.regeneration(true);
+    small.stream_size(256);
+    large.stream_size(2048);
+    // a new context for every frame
+    vector<unique_ptr<FrameBuffer>> fresh;
+    auto start = chrono::steady_clock::now();
+    for (size_t f = 0; f < n_frames; f++) {
+        RenderContext ctx;
+        Renderer& renderer = (f % 2 == 0)? small : large;
+        renderer.context(ctx);
+        fresh.emplace_back(new FrameBuffer(n_pixels, n_pixels));
+        renderer.render(*fresh.back());
+    }
+    double t_fresh = seconds_since(start);
+    // a single context for all frames
+    RenderContext shared;
+    small.context(shared);
+    large.context(shared);
+    size_t n = 0;
+    start = chrono::steady_clock::now();
+    for (size_t f = 0; f < n_frames; f++) {
+        FrameBuffer fb(n_pixels, n_pixels);
+        ((f % 2 == 0)? small : large).render(fb);
+        n += n_differ(fb, *fresh[f]);
+    }
+    double t_shared = seconds_since(start);
+    cout << "  " << shared.n_workers() << " workers, new context per frame: " << n_frames / t_fresh
+         << " frames/s, shared context: " << n_frames / t_shared << " frames/s, " << n << " bytes differ" << endl;
+}
@@ -0,0 +1,56 @@
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include "./common.hpp"
+#include "../src/renderer.hpp"
+#include "../src/context.hpp"
+
+using namespace std;
+
+// benchmark of the placement of the workers and the scene on
+// the numa nodes of the machine, the detected topology is
+// compared against simulated topologies with more nodes with
+// and without pinning the workers and replicating the scene,
+// all renders have to give the same image
+
+// size of the image and samples per pixel
+const size_t n_pixels = 128;
+const size_t spp = 8;
+
+int main(void) {
+    // the scene of the main program
+    Camera cam = cornell_camera();
+    unique_ptr<Scene> cornell = cornell_scene();
+    const Scene& scene = *cornell;
+    // the image of the default context
+    Renderer renderer(scene, cam, spp, 10);
+    renderer.regeneration(true);
+    FrameBuffer reference(n_pixels, n_pixels);
+    renderer.render(reference);
+    NumaTopology detected = NumaTopology::detect();
+    cout << "detected " << detected.n_nodes() << " node(s), scene takes " << scene.n_bytes() / 1024.0 << "KB" << endl;
+    vector<pair<string, NumaTopology>> topologies = {
+        { "detected", detected },
+        { "2 simulated nodes", NumaTopology::simulated(2) },
+        { "4 simulated nodes", NumaTopology::simulated(4) }
+    };
+    for (const pair<string, NumaTopology>& t : topologies) {
+        for (const bool& pinning : { false, true }) {
+            for (const bool& replication : { false, true }) {
+                RenderContext ctx(t.second, pinning);
+                ctx.replication(replication);
+                Renderer r(scene, cam, spp, 10);
+                r.regeneration(true);
+                r.context(ctx);
+                FrameBuffer fb(n_pixels, n_pixels);
+                auto start = chrono::steady_clock::now();
+                r.render(fb);
+                double t_render = seconds_since(start);
+                cout << "  " << t.first << (pinning? ", pinned" : "") << (replication? ", replicated" : "") << ": "
+                     << t_render * 1e3 << "ms, " << ctx.n_workers() << " workers, " << ctx.n_stolen()
+                     << " tiles stolen, " << n_differ(fb, reference) << " bytes differ" << endl;
+            }
+        }
+    }
+}
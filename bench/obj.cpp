@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include "./common.hpp"
+#include "../src/vec.hpp"
+#include "../src/mesh.hpp"
+
+using namespace std;
+
+// benchmark of the obj loader on generated grid meshes, once
+// with plain face indices and once with slashed and negative
+// indices, compared against a simple stream based parser and
+// against loading the binary mesh cache
+
+// number of vertices along each side of the grid
+const size_t n_grid = 1024;
+
+// write a grid of quads to an obj file
+void write_grid(const char* fpath, const bool& fancy) {
+    FILE* f = fopen(fpath, "w");
+    fprintf(f, "# generated grid\no grid\n");
+    for (size_t i = 0; i < n_grid; i++) {
+        for (size_t j = 0; j < n_grid; j++) {
+            fprintf(f, "v %.6f %.6f %.6e\n", i / (float)n_grid, j / (float)n_grid, 1e-3f * ((i * j) % 7));
+        }
+    }
+    for (size_t i = 0; i + 1 < n_grid; i++) {
+        for (size_t j = 0; j + 1 < n_grid; j++) {
+            size_t a = i * n_grid + j + 1, b = a + 1, c = a + n_grid + 1, d = a + n_grid;
+            if (!fancy) {
+                fprintf(f, "f %zu %zu %zu %zu\n", a, b, c, d);
+            } else if ((i + j) % 2 == 0) {
+                fprintf(f, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu %zu//%zu\n", a, a, a, b, b, b, c, c, c, d, d);
+            } else {
+                // negative indices relative to the end of the vertices
+                long n = n_grid * n_grid + 1;
+                fprintf(f, "f %ld %ld %ld %ld\n", (long)a - n, (long)b - n, (long)c - n, (long)d - n);
+            }
+        }
+    }
+    fclose(f);
+}
+
+// stream based parser reading one token at a time
+size_t load_stream(const char* fpath, vector<Vec3f>& vs) {
+    ifstream f(fpath);
+    string tok;
+    size_t n_triangles = 0;
+    while (f >> tok) {
+        if (tok == "v") {
+            float x, y, z; f >> x >> y >> z;
+            vs.push_back(Vec3f(x, y, z));
+        } else if (tok == "f") {
+            size_t i, j, k; f >> i >> j;
+            do { f >> k; n_triangles++; j = k; } while (f.peek() != '\n');
+        }
+        f.ignore(1 << 20, '\n');
+    }
+    return n_triangles;
+}
+
+// sum of all vertex coordinates of a mesh
+double checksum(const Mesh& mesh) {
+    double sum = 0.0;
+    for (const uint32_t& i : mesh.indices()) {
+        const Vec3f& v = mesh.vertices()[i];
+        sum += v[0] + v[1] + v[2];
+    }
+    return sum;
+}
+
+int main(void) {
+    const char* plain = "/tmp/fairpt_bench_plain.obj";
+    const char* fancy = "/tmp/fairpt_bench_fancy.obj";
+    write_grid(plain, false);
+    write_grid(fancy, true);
+    for (const char* fpath : { plain, fancy }) {
+        ifstream f(fpath, ios::ate);
+        double gb = f.tellg() / 1e9;
+        cout << fpath << " (" << gb * 1e3 << "MB)" << endl;
+        // load with the mesh loader
+        auto start = chrono::steady_clock::now();
+        Mesh mesh = Mesh::load_obj(fpath, nullptr);
+        double s = seconds_since(start);
+        cout << "  load_obj: " << s << "s, " << gb / s << "GB/s, "
+             << mesh.n_vertices() << " vertices, " << mesh.size() << " triangles, "
+             << "checksum " << checksum(mesh) << endl;
+        // write the binary cache and load it
+        const char* cache = "/tmp/fairpt_bench.mesh";
+        mesh.save_cache(cache);
+        start = chrono::steady_clock::now();
+        Mesh cached = Mesh::load_cache(cache, { nullptr });
+        s = seconds_since(start);
+        ifstream c(cache, ios::ate);
+        cout << "  cache:    " << s << "s, " << c.tellg() / 1e9 / s << "GB/s ("
+             << c.tellg() / 1e6 << "MB), checksum " << checksum(cached) << endl;
+        remove(cache);
+        // the stream parser does not support
+        // the slashed and negative indices
+        if (fpath == plain) {
+            vector<Vec3f> vs;
+            start = chrono::steady_clock::now();
+            size_t n = load_stream(fpath, vs);
+            s = seconds_since(start);
+            cout << "  stream:   " << s << "s, " << gb / s << "GB/s, "
+                 << vs.size() << " vertices, " << n << " triangles" << endl;
+        }
+        remove(fpath);
+    }
+}
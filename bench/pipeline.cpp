@@ -0,0 +1,51 @@
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include "./common.hpp"
+#include "../src/renderer.hpp"
+#include "../src/context.hpp"
+
+using namespace std;
+
+// benchmark of the pipelined mode of the renderer, where the
+// sort, intersect and shade stages of the bounces of several
+// batches of paths run as separate tasks, against rendering
+// each tile by a single worker, both have to give the same
+// image as the samples do not depend on the schedule
+
+// size of the image and samples per pixel
+const size_t n_pixels = 128;
+const size_t spp = 16;
+
+int main(void) {
+    // the scene of the main program
+    Camera cam = cornell_camera();
+    unique_ptr<Scene> cornell = cornell_scene(2);
+    const Scene& scene = *cornell;
+    // contexts with as many workers as there are hardware
+    // threads and with more workers than that
+    size_t n_threads = std::max<size_t>(1, thread::hardware_concurrency());
+    for (const size_t& n_workers : { n_threads, 2 * n_threads }) {
+        RenderContext ctx(n_workers);
+        for (const bool& reordering : { false, true }) {
+            FrameBuffer tiled(n_pixels, n_pixels), pipelined(n_pixels, n_pixels);
+            Renderer renderer(scene, cam, spp, 10);
+            renderer.regeneration(true);
+            renderer.reordering(reordering);
+            renderer.context(ctx);
+            auto start = chrono::steady_clock::now();
+            renderer.render(tiled);
+            double t_tiled = seconds_since(start);
+            renderer.pipelining(true);
+            start = chrono::steady_clock::now();
+            renderer.render(pipelined);
+            double t_pipelined = seconds_since(start);
+            double n_rays = renderer.stats().n_rays;
+            cout << "  " << n_workers << " workers" << (reordering? ", reordering" : "") << ": tiles " << n_rays / t_tiled / 1e6
+                 << "M rays/s, pipelined " << n_rays / t_pipelined / 1e6 << "M rays/s, "
+                 << n_differ(tiled, pipelined) << " bytes differ" << endl;
+        }
+    }
+}
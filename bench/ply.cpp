@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include "../src/vec.hpp"
+#include "../src/mesh.hpp"
+
+using namespace std;
+
+// benchmark of the binary ply loader on a generated grid
+// mesh written in both byte orders, the vertices carry
+// normals and colors and the faces a flag that are skipped
+
+// number of vertices along each side of the grid
+const size_t n_grid = 1024;
+
+// write a value in the requested byte order
+template<typename T>
+void put(FILE* f, const T& value, const bool& big) {
+    char b[sizeof(T)];
+    memcpy(b, &value, sizeof(T));
+    if (big) { for (size_t k = 0; k < sizeof(T) / 2; k++) { swap(b[k], b[sizeof(T) - 1 - k]); } }
+    fwrite(b, 1, sizeof(T), f);
+}
+
+void write_grid(const char* fpath, const bool& big) {
+    FILE* f = fopen(fpath, "wb");
+    fprintf(f, "ply\nformat %s 1.0\ncomment generated grid\n", big? "binary_big_endian" : "binary_little_endian");
+    fprintf(f, "element vertex %zu\nproperty float x\nproperty float y\nproperty float z\n", n_grid * n_grid);
+    fprintf(f, "property float nx\nproperty float ny\nproperty float nz\nproperty uchar red\n");
+    fprintf(f, "element face %zu\nproperty list uchar int vertex_indices\nproperty int flags\nend_header\n", (n_grid - 1) * (n_grid - 1));
+    for (size_t i = 0; i < n_grid; i++) {
+        for (size_t j = 0; j < n_grid; j++) {
+            put(f, i / (float)n_grid, big); put(f, j / (float)n_grid, big); put(f, 1e-3f * ((i * j) % 7), big);
+            put(f, 0.0f, big); put(f, 0.0f, big); put(f, 1.0f, big); put(f, (uint8_t)255, big);
+        }
+    }
+    for (size_t i = 0; i + 1 < n_grid; i++) {
+        for (size_t j = 0; j + 1 < n_grid; j++) {
+            int32_t a = i * n_grid + j, b = a + 1, c = a + n_grid + 1, d = a + n_grid;
+            put(f, (uint8_t)4, big);
+            put(f, a, big); put(f, b, big); put(f, c, big); put(f, d, big);
+            put(f, (int32_t)0, big);
+        }
+    }
+    fclose(f);
+}
+
+// sum of all vertex coordinates of a mesh
+double checksum(const Mesh& mesh) {
+    double sum = 0.0;
+    for (const uint32_t& i : mesh.indices()) {
+        const Vec3f& v = mesh.vertices()[i];
+        sum += v[0] + v[1] + v[2];
+    }
+    return sum;
+}
+
+int main(void) {
+    const char* little = "/tmp/fairpt_bench_le.ply";
+    const char* big = "/tmp/fairpt_bench_be.ply";
+    write_grid(little, false);
+    write_grid(big, true);
+    for (const char* fpath : { little, big }) {
+        ifstream f(fpath, ios::ate);
+        double gb = f.tellg() / 1e9;
+        auto start = chrono::steady_clock::now();
+        Mesh mesh = Mesh::load_ply(fpath, nullptr);
+        auto stop = chrono::steady_clock::now();
+        double s = chrono::duration_cast<chrono::microseconds>(stop - start).count() / 1e6;
+        cout << fpath << " (" << gb * 1e3 << "MB): " << s << "s, " << gb / s << "GB/s, "
+             << mesh.n_vertices() << " vertices, " << mesh.size() << " triangles, "
+             << "checksum " << checksum(mesh) << endl;
+        remove(fpath);
+    }
+}
@@ -0,0 +1,135 @@
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "./common.hpp"
+#include "../src/renderer.hpp"
+#include "../src/context.hpp"
+#include "../src/hugepages.hpp"
+
+using namespace std;
+
+// benchmark of the prefetching during traversal and intersection
+// and of the huge pages backing the tree and the packets, a large
+// grid scene is rendered with all four combinations, the misses of
+// the data tlb are read from the performance counters if the
+// kernel allows it, the images have to be the same as neither
+// changes the rays
+
+// number of vertices along each side of the grid,
+// size of the image and samples per pixel
+const size_t n_grid = 768;
+const size_t n_pixels = 256;
+const size_t spp = 4;
+
+// wavy grid of unit quads facing up using two
+// materials in a checker pattern
+Mesh grid(const mtl::Material* a, const mtl::Material* b) {
+    Mesh mesh;
+    mesh.reserve(n_grid * n_grid, 2 * (n_grid - 1) * (n_grid - 1));
+    for (size_t i = 0; i < n_grid; i++) {
+        for (size_t j = 0; j < n_grid; j++) {
+            mesh.add_vertex(Vec3f(i, j, 10.0f * sinf(0.1f * i) * cosf(0.1f * j)));
+        }
+    }
+    for (size_t i = 0; i + 1 < n_grid; i++) {
+        for (size_t j = 0; j + 1 < n_grid; j++) {
+            uint32_t v = i * n_grid + j;
+            const mtl::Material* mat = ((i / 16 + j / 16) % 2 == 0)? a : b;
+            mesh.add_triangle(v, v + 1, v + n_grid, mat);
+            mesh.add_triangle(v + 1, v + n_grid + 1, v + n_grid, mat);
+        }
+    }
+    return mesh;
+}
+
+// counter of the data tlb misses of loads in user space of
+// the calling thread and the threads it starts afterwards,
+// -1 if the counter is not available
+int open_dtlb_counter(void) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// the amount of anonymous memory of the
+// process backed by transparent huge pages
+size_t anon_huge_kb(void) {
+    ifstream f("/proc/self/smaps_rollup");
+    string line;
+    while (getline(f, line)) {
+        if (line.rfind("AnonHugePages:", 0) != 0) { continue; }
+        try { return stoull(line.substr(14)); } catch (const exception&) { break; }
+    }
+    return 0;
+}
+
+int main(void) {
+    Arena arena;
+    mtl::Material* a = arena.create<mtl::Lambertian>(arena.create<txr::Constant>(Vec3f(0.75f, 0.75f, 0.75f)));
+    mtl::Material* b = arena.create<mtl::Metallic>(arena.create<txr::Constant>(Vec3f(0.9f, 0.9f, 0.9f)), 0.3f);
+    Mesh mesh = grid(a, b);
+    // look at the whole grid from above at a slant such
+    // that the bounces travel far across the grid
+    Camera cam(Vec3f(0.5f, -0.1f, 0.4f) * n_grid, Vec3f(0.0f, 1.0f, -0.6f), Vec3f(0, 0, 1));
+    cam.fov(70.0f);
+    cout << mesh.size() << " triangles" << endl;
+    vector<unique_ptr<FrameBuffer>> images;
+    for (const bool& huge : { false, true }) {
+        // the arrays of the scene are allocated with
+        // the setting at the time the scene is built
+        huge_pages(huge);
+        size_t kb_before = anon_huge_kb();
+        auto start = chrono::steady_clock::now();
+        Scene scene(mesh);
+        double t_build = seconds_since(start);
+        cout << "huge pages " << (huge? "on" : "off") << ": build " << t_build << "s, "
+             << scene.n_bytes() / (1 << 20) << "MB in the scene, "
+             << ((double)anon_huge_kb() - kb_before) / 1024 << "MB more in transparent huge pages" << endl;
+        for (const bool& prefetching : { false, true }) {
+            // open the counter before the workers are started
+            // such that it counts their misses, the counts of
+            // the workers are added once they are joined
+            int fd = open_dtlb_counter();
+            if (fd >= 0) { ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); }
+            images.emplace_back(new FrameBuffer(n_pixels, n_pixels));
+            FrameBuffer& fb = *images.back();
+            Renderer renderer(scene, cam, spp, 4);
+            renderer.regeneration(true);
+            renderer.prefetching(prefetching);
+            double t_render;
+            {
+                RenderContext ctx;
+                renderer.context(ctx);
+                start = chrono::steady_clock::now();
+                renderer.render(fb);
+                t_render = seconds_since(start);
+            }
+            long long n_misses = -1;
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(fd, &n_misses, sizeof(n_misses)) != sizeof(n_misses)) { n_misses = -1; }
+                close(fd);
+            }
+            double n_rays = renderer.stats().n_rays;
+            cout << "  prefetching " << (prefetching? "on" : "off") << ": " << n_rays / t_render / 1e6 << "M rays/s, dtlb misses ";
+            if (n_misses >= 0) { cout << n_misses / n_rays << " per ray"; } else { cout << "n/a"; }
+            cout << ", " << n_differ(fb, *images.front()) << " bytes differ" << endl;
+        }
+    }
+}
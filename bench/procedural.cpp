@@ -0,0 +1,52 @@
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include <rng.hpp>
+#include "./common.hpp"
+#include "../src/vec.hpp"
+#include "../src/texture.hpp"
+
+using namespace std;
+
+// benchmark of the procedural textures evaluated one point
+// at a time through the virtual single point function against
+// the batched function evaluating eight points at a time
+
+// number of points and size of the batches
+const size_t n_points = 1 << 20;
+const size_t batch_size = 256;
+
+int main(void) {
+    // random points in a box
+    vector<float> px(n_points), py(n_points), pz(n_points);
+    for (size_t i = 0; i < n_points; i++) {
+        px[i] = 20.0f * rng::randf();
+        py[i] = 20.0f * rng::randf();
+        pz[i] = 20.0f * rng::randf();
+    }
+    txr::Checker checker(Vec3f::zeros, Vec3f::ones, 0.5f);
+    txr::Noise noise(Vec3f::zeros, Vec3f::ones, 2.0f);
+    txr::Noise fbm(Vec3f::zeros, Vec3f::ones, 2.0f, 4);
+    txr::Gradient gradient(Vec3f::zeros, Vec3f::ones, Vec3f::zeros, Vec3f(20.0f, 20.0f, 0.0f));
+    vector<pair<const char*, const txr::Texture*>> textures = {
+        { "checker", &checker }, { "noise", &noise }, { "noise (4 octaves)", &fbm }, { "gradient", &gradient }
+    };
+    vector<Vec3f> single(n_points), batched(n_points);
+    for (const pair<const char*, const txr::Texture*>& t : textures) {
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < n_points; i++) { single[i] = t.second->color(Vec3f(px[i], py[i], pz[i])); }
+        double t_single = seconds_since(start);
+        start = chrono::steady_clock::now();
+        for (size_t i = 0; i < n_points; i += batch_size) {
+            t.second->color(&px[i], &py[i], &pz[i], batch_size, &batched[i]);
+        }
+        double t_batched = seconds_since(start);
+        // both have to give the same colors
+        size_t n_differ = 0;
+        for (size_t i = 0; i < n_points; i++) {
+            n_differ += (single[i][0] != batched[i][0]) || (single[i][1] != batched[i][1]) || (single[i][2] != batched[i][2]);
+        }
+        cout << "  " << t.first << ": single " << n_points / t_single / 1e6 << "M points/s, batched "
+             << n_points / t_batched / 1e6 << "M points/s, " << n_differ << " differ" << endl;
+    }
+}
@@ -0,0 +1,94 @@
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include <rng.hpp>
+#include "../src/vec.hpp"
+#include "../src/primitive.hpp"
+
+using namespace std;
+
+// microbenchmark comparing the closest-hit search
+// over the packets of a leaf using a scalar loop
+// over the distances against the simd reduction
+
+// number of packets per leaf and number of leafs
+const size_t n_packets = 8;
+const size_t n_leafs = 1 << 16;
+const size_t n_repeats = 32;
+
+// closest-hit search storing each packet to
+// memory and scanning the distances one by one
+template<typename VecT>
+bool scalar_closest(const VecT* ts, const VecT* us, const VecT* vs, const size_t& n, Hit& hit) {
+    bool is_closer = false;
+    for (size_t k = 0; k < n; k++) {
+        for (size_t j = 0; j < VecT::width; j++) {
+            if ((ts[k][j] > 0) && (ts[k][j] < hit.t)) {
+                hit.t = ts[k][j]; hit.u = us[k][j]; hit.v = vs[k][j];
+                hit.prim_id = k * VecT::width + j;
+                is_closer = true;
+            }
+        }
+    }
+    return is_closer;
+}
+
+// closest-hit search keeping the running
+// minimum in registers
+template<typename VecT>
+bool simd_closest(const VecT* ts, const VecT* us, const VecT* vs, const size_t& n, Hit& hit) {
+    ClosestHit<VecT> closest(hit.t);
+    for (size_t k = 0; k < n; k++) { closest.update(ts[k], us[k], vs[k], k); }
+    return closest.reduce(hit.t, hit.u, hit.v, hit.prim_id);
+}
+
+template<typename VecT>
+void run(const char* name) {
+    // fill the packets with random distances where
+    // about a quarter of the lanes miss
+    size_t n = n_leafs * n_packets * 4 / VecT::width;
+    vector<VecT> ts(n), us(n), vs(n);
+    for (size_t k = 0; k < n; k++) {
+        for (size_t j = 0; j < VecT::width; j++) {
+            float r = rng::randf();
+            ts[k][j] = (r < 0.25f)? -1.0f : r * 100.0f;
+            us[k][j] = rng::randf();
+            vs[k][j] = rng::randf();
+        }
+    }
+    // note that the packet count is read from a volatile to
+    // keep the compiler from specializing the search loops
+    volatile size_t m_volatile = n_packets * 4 / VecT::width;
+    size_t m = m_volatile;
+    // time both variants and make sure
+    // they find the same hits
+    double checksum[2] = { 0.0, 0.0 };
+    double ms[2];
+    for (size_t variant = 0; variant < 2; variant++) {
+        auto start = chrono::steady_clock::now();
+        for (size_t r = 0; r < n_repeats; r++) {
+            for (size_t l = 0; l < n_leafs; l++) {
+                Hit hit; hit.t = 50.0f + r;
+                bool found = (variant == 0)?
+                    scalar_closest(&ts[l * m], &us[l * m], &vs[l * m], m, hit) :
+                    simd_closest(&ts[l * m], &us[l * m], &vs[l * m], m, hit);
+                if (found) { checksum[variant] += hit.t + hit.u + hit.prim_id; }
+            }
+        }
+        auto stop = chrono::steady_clock::now();
+        ms[variant] = chrono::duration_cast<chrono::microseconds>(stop - start).count() / 1000.0;
+    }
+    size_t n_calls = n_leafs * n_repeats;
+    cout << name << ": scalar " << ms[0] * 1e6 / n_calls << "ns/leaf, "
+         << "simd " << ms[1] * 1e6 / n_calls << "ns/leaf, "
+         << "speedup " << ms[0] / ms[1] << "x"
+         << ((checksum[0] == checksum[1])? "" : " (MISMATCH)") << endl;
+}
+
+int main(void) {
+    cout << "Closest-hit reduction over " << n_packets * 4 << " primitives per leaf" << endl;
+    run<Vec4f>("Vec4f");
+#ifdef __AVX__
+    run<Vec8f>("Vec8f");
+#endif
+}
@@ -0,0 +1,113 @@
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <iostream>
+#include "./common.hpp"
+#include "../src/sampler.hpp"
+#include "../src/renderer.hpp"
+
+using namespace std;
+
+// convergence benchmark of the samplers, first on a smooth
+// integral over the unit square with a known value and then on
+// a small render of the cornell box compared to a reference
+// with many samples per pixel, the error is the root mean
+// squared error over all pixels
+
+// size of the image and samples per pixel of the reference
+const size_t n_pixels = 48;
+const size_t reference_spp = 1024;
+
+// estimate the integral of a gaussian bump over
+// the unit square in every pixel
+vector<Vec3f> integrate(const Sampler& sampler, const size_t& spp) {
+    vector<Vec3f> estimates;
+    for (uint32_t y = 0; y < n_pixels; y++) {
+        for (uint32_t x = 0; x < n_pixels; x++) {
+            double sum = 0.0;
+            for (uint32_t k = 0; k < spp; k++) {
+                float u = sampler.get(x, y, k, 2), v = sampler.get(x, y, k, 3);
+                sum += exp(-(u * u + v * v));
+            }
+            estimates.push_back(Vec3f(sum / spp));
+        }
+    }
+    return estimates;
+}
+
+// render the whole image as a single tile and return the
+// average color of each pixel before any post-processing
+vector<Vec3f> render(const Scene& scene, const Camera& cam, const Sampler& sampler, const size_t& spp) {
+    Renderer renderer(scene, cam, spp, 10);
+    renderer.regeneration(true);
+    renderer.sampler(sampler);
+    FrameBuffer fb(n_pixels, n_pixels);
+    RenderArgs args(renderer.stream_size(), scene.bvh());
+    float vpw = 2.0f * tanf(0.5f * cam.fov());
+    RenderTile tile = { 0, 0, n_pixels, n_pixels, n_pixels, n_pixels, vpw, vpw };
+    renderer.render_tile(args, tile, fb);
+    vector<Vec3f> colors(args.pixel_colors.size());
+    for (size_t p = 0; p < colors.size(); p++) { colors[p] = args.pixel_colors[p] / (float)spp; }
+    return colors;
+}
+
+// error of the pixels and the error after averaging over
+// 3x3 pixels which is roughly what the eye perceives, the
+// blue-noise sampler moves the error to high frequencies
+// that the averaging removes
+double rmse(const vector<Vec3f>& a, const vector<Vec3f>& b, const bool& blurred) {
+    double sq_err = 0.0;
+    for (size_t i = 0; i < n_pixels; i++) {
+        for (size_t j = 0; j < n_pixels; j++) {
+            Vec3f d = a[i * n_pixels + j] - b[i * n_pixels + j];
+            if (blurred) {
+                d = Vec3f::zeros;
+                for (size_t k = 0; k < 9; k++) {
+                    size_t p = ((i + n_pixels + k / 3 - 1) % n_pixels) * n_pixels + (j + n_pixels + k % 3 - 1) % n_pixels;
+                    d = d + (a[p] - b[p]) / 9.0f;
+                }
+            }
+            sq_err += d.dot(d)[0] / 3.0;
+        }
+    }
+    return sqrt(sq_err / (n_pixels * n_pixels));
+}
+
+int main(void) {
+    RandomSampler random;
+    SobolSampler sobol;
+    auto start = chrono::steady_clock::now();
+    BlueNoiseSampler blue_noise;
+    cout << "blue-noise mask built in " << seconds_since(start) * 1e3 << "ms" << endl;
+    vector<pair<const char*, const Sampler*>> samplers = {
+        { "random", &random }, { "sobol", &sobol }, { "blue-noise", &blue_noise }
+    };
+    // integral of a smooth function
+    vector<Vec3f> exact(n_pixels * n_pixels, Vec3f(0.5577462853510335f));
+    cout << "integral error:" << endl;
+    for (const int& spp : { 4, 16, 64, 256 }) {
+        cout << "  " << spp << " spp:";
+        for (const pair<const char*, const Sampler*>& s : samplers) {
+            vector<Vec3f> estimates = integrate(*s.second, spp);
+            cout << " " << s.first << " " << rmse(estimates, exact, false) << " (" << rmse(estimates, exact, true) << " blurred)";
+        }
+        cout << endl;
+    }
+    // the scene of the main program
+    Camera cam = cornell_camera();
+    unique_ptr<Scene> cornell = cornell_scene();
+    const Scene& scene = *cornell;
+    // error of the renders against the reference
+    start = chrono::steady_clock::now();
+    vector<Vec3f> reference = render(scene, cam, sobol, reference_spp);
+    cout << "render error (reference with " << reference_spp << " spp in " << seconds_since(start) << "s):" << endl;
+    for (const int& spp : { 4, 16, 64 }) {
+        cout << "  " << spp << " spp:";
+        for (const pair<const char*, const Sampler*>& s : samplers) {
+            vector<Vec3f> colors = render(scene, cam, *s.second, spp);
+            cout << " " << s.first << " " << rmse(colors, reference, false) << " (" << rmse(colors, reference, true) << " blurred)";
+        }
+        cout << endl;
+    }
+}
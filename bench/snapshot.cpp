@@ -0,0 +1,121 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <iostream>
+#include <rng.hpp>
+#include "./common.hpp"
+#include "../src/vec.hpp"
+#include "../src/ray.hpp"
+#include "../src/mesh.hpp"
+#include "../src/scene.hpp"
+#include "../src/texture.hpp"
+#include "../src/material.hpp"
+
+using namespace std;
+
+// benchmark comparing the time to the first ray when building
+// the scene from a mesh against loading a scene snapshot, both
+// scenes have to report the same hits for a set of random rays
+
+// number of vertices along each side of the grid
+const size_t n_grid = 1024;
+const size_t n_rays = 1 << 16;
+const char* fpath = "/tmp/bench_snapshot.scene";
+
+// wavy grid of unit quads facing up using two materials
+// in a checker pattern, note that the triangles must not be
+// too small for the determinant test of möller-trumbore
+Mesh grid(const mtl::Material* a, const mtl::Material* b) {
+    Mesh mesh;
+    mesh.reserve(n_grid * n_grid, 2 * (n_grid - 1) * (n_grid - 1));
+    for (size_t i = 0; i < n_grid; i++) {
+        for (size_t j = 0; j < n_grid; j++) {
+            mesh.add_vertex(Vec3f(i, j, 10.0f * sinf(0.1f * (i + j))));
+        }
+    }
+    for (size_t i = 0; i + 1 < n_grid; i++) {
+        for (size_t j = 0; j + 1 < n_grid; j++) {
+            uint32_t v = i * n_grid + j;
+            const mtl::Material* mat = ((i / 64 + j / 64) % 2 == 0)? a : b;
+            mesh.add_triangle(v, v + 1, v + n_grid, mat);
+            mesh.add_triangle(v + 1, v + n_grid + 1, v + n_grid, mat);
+        }
+    }
+    return mesh;
+}
+
+// closest hit distance and material of each ray
+void cast(const Scene& scene, const RayStream& rays, vector<float>& ts, vector<const mtl::Material*>& mtls) {
+    LeafSortBuffer buffer;
+    RayStream sorted;
+    scene.bvh().sort_rays_by_leafs(rays, buffer, sorted);
+    vector<Hit> hits(rays.size());
+    for (const LeafRange& range : buffer.ranges) {
+        for (size_t k = range.begin; k < range.end; k++) {
+            scene.cast(sorted.broadcast(k), range.leaf_id, hits[sorted.path[k]]);
+        }
+    }
+    ts.resize(rays.size());
+    mtls.resize(rays.size());
+    for (size_t r = 0; r < rays.size(); r++) {
+        HitRecord record;
+        record.mat = nullptr;
+        if (hits[r].type != PrimitiveType::None) {
+            scene.surface(hits[r], rays.get(r).origin, rays.get(r).direction, record);
+        }
+        ts[r] = hits[r].t;
+        mtls[r] = record.mat;
+    }
+}
+
+int main(void) {
+    txr::Constant white(Vec3f::ones), grey(Vec3f::ones * 0.5f);
+    mtl::Lambertian a(&white), b(&grey);
+    vector<const mtl::Material*> materials = { &a, &b };
+    Mesh mesh = grid(&a, &b);
+    // some spheres above the grid
+    vector<Sphere> spheres;
+    BoundableList objects;
+    for (size_t i = 0; i < 16; i++) { spheres.push_back(Sphere(Vec3f(rng::randf(), rng::randf(), 0.1f) * n_grid, 0.05f * n_grid, &b)); }
+    for (Sphere& s : spheres) { objects.push_back(&s); }
+    // rays from above aimed at the grid
+    RayStream rays;
+    for (size_t r = 0; r < n_rays; r++) {
+        Vec3f o = Vec3f(rng::randf(), rng::randf(), 1.0f) * n_grid;
+        Vec3f p = Vec3f(rng::randf(), rng::randf(), 0.0f) * n_grid;
+        rays.push_back({ o, (p - o).normalize() }, r);
+        rays.tmax[r] = std::numeric_limits<float>::infinity();
+    }
+    cout << mesh.size() << " triangles and " << objects.size() << " spheres" << endl;
+    vector<float> ts_built, ts_loaded;
+    vector<const mtl::Material*> mtls_built, mtls_loaded;
+    for (const TriangleKernel& kernel : { TriangleKernel::MollerTrumbore, TriangleKernel::Plane }) {
+        // build the scene and write the snapshot
+        auto start = chrono::steady_clock::now();
+        Scene built(mesh, objects, kernel);
+        double t_build = seconds_since(start);
+        start = chrono::steady_clock::now();
+        bool saved = built.save_snapshot(fpath, materials);
+        double t_save = seconds_since(start);
+        // load the snapshot and cast the first ray
+        start = chrono::steady_clock::now();
+        Scene loaded;
+        bool ok = loaded.load_snapshot(fpath, materials);
+        Hit hit;
+        if (ok && (loaded.bvh().num_leafs() > 0)) { loaded.cast(rays.broadcast(0), 0, hit); }
+        double t_load = seconds_since(start);
+        // compare the hits of both scenes
+        cast(built, rays, ts_built, mtls_built);
+        cast(loaded, rays, ts_loaded, mtls_loaded);
+        size_t n_hits = 0, n_differ = 0;
+        for (size_t r = 0; r < n_rays; r++) {
+            n_hits += (mtls_built[r] != nullptr);
+            n_differ += (ts_built[r] != ts_loaded[r]) || (mtls_built[r] != mtls_loaded[r]);
+        }
+        cout << "  kernel " << (int)kernel << ": build " << t_build * 1e3 << "ms, save "
+             << t_save * 1e3 << "ms" << (saved? "" : " (failed)") << ", load and first ray "
+             << t_load * 1e3 << "ms" << (ok? "" : " (failed)") << ", "
+             << loaded.bvh().num_nodes() << " nodes, " << n_hits << " hits, " << n_differ << " differ" << endl;
+    }
+    remove(fpath);
+}
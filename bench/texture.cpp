@@ -0,0 +1,80 @@
+#include <chrono>
+#include <vector>
+#include <numeric>
+#include <iostream>
+#include <rng.hpp>
+#include "./common.hpp"
+#include "../src/vec.hpp"
+#include "../src/texture.hpp"
+
+using namespace std;
+
+// benchmark of image texture lookups on a large texture seen
+// through a grid of screen samples at different distances,
+// once always filtering the full resolution level and once
+// choosing the mip levels from the footprint of the samples,
+// the samples are taken in scanline order and in random
+// order as for incoherent secondary rays
+
+// size of the texture and of the grid of samples
+const size_t n_texels = 4096;
+const size_t n_screen = 512;
+
+// sample the texture over the grid in the given order where
+// the grid covers the given number of repetitions of the texture
+double run(
+    const txr::Image& img,
+    const vector<uint32_t>& order,
+    const float& repeats,
+    const bool& mipmapped,
+    Vec3f& sum
+) {
+    // width of a sample in texture space
+    float width = repeats / n_screen;
+    auto start = chrono::steady_clock::now();
+    for (const uint32_t& i : order) {
+        size_t x = i % n_screen, y = i / n_screen;
+        txr::TexCoord uv = { (x + 0.5f) * width, (y + 0.5f) * width };
+        sum = sum + img.sample(Vec3f::zeros, uv, mipmapped? width : 0.0f);
+    }
+    return order.size() / seconds_since(start);
+}
+
+int main(void) {
+    // procedural image with fine details
+    vector<uint8_t> rgb(3 * n_texels * n_texels);
+    for (size_t y = 0; y < n_texels; y++) {
+        for (size_t x = 0; x < n_texels; x++) {
+            uint8_t* c = &rgb[3 * (y * n_texels + x)];
+            c[0] = ((x ^ y) & 8)? 220 : 20;
+            c[1] = (x * 255) / n_texels;
+            c[2] = (y * 255) / n_texels;
+        }
+    }
+    auto start = chrono::steady_clock::now();
+    txr::Image img(n_texels, n_texels, rgb.data());
+    cout << n_texels << "x" << n_texels << " texture with " << img.n_levels()
+         << " levels built in " << seconds_since(start) * 1e3 << "ms" << endl;
+    // scanline and shuffled order of the samples
+    vector<uint32_t> scanline(n_screen * n_screen), shuffled;
+    iota(scanline.begin(), scanline.end(), 0);
+    shuffled = scanline;
+    for (size_t i = shuffled.size() - 1; i > 0; i--) {
+        swap(shuffled[i], shuffled[(size_t)(rng::randf() * (i + 1)) % (i + 1)]);
+    }
+    // from magnification to minification, note that more than
+    // one repetition would revisit the same few texels
+    Vec3f sum = Vec3f::zeros;
+    for (const float& repeats : { 0.0625f, 0.25f, 1.0f }) {
+        cout << "  " << repeats * n_texels / n_screen << " texels per sample" << endl;
+        for (const vector<uint32_t>* order : { &scanline, &shuffled }) {
+            double full = run(img, *order, repeats, false, sum);
+            double mip = run(img, *order, repeats, true, sum);
+            cout << "    " << ((order == &scanline)? "scanline: " : "shuffled: ")
+                 << "level zero " << full / 1e6 << "M samples/s, trilinear "
+                 << mip / 1e6 << "M samples/s" << endl;
+        }
+    }
+    // keep the results alive
+    cout << "  (checksum " << sum[0] + sum[1] + sum[2] << ")" << endl;
+}
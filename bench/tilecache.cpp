@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <numeric>
+#include <iostream>
+#include <rng.hpp>
+#include "./common.hpp"
+#include "../src/vec.hpp"
+#include "../src/texture.hpp"
+#include "../src/tilecache.hpp"
+
+using namespace std;
+
+// benchmark of image texture lookups through the tile cache
+// with memory budgets from a small fraction of the texture to
+// the full texture, compared against the texture in memory,
+// the samples are spread over all threads in random order
+// as for incoherent secondary rays
+
+// size of the texture and number of samples
+const size_t n_texels = 4096;
+const size_t n_samples = 1 << 21;
+const char* fpath = "/tmp/bench_tilecache.tiled";
+
+// sample the texture at the given coordinates using all threads
+double run(const txr::Texture& tex, const vector<txr::TexCoord>& uvs, const float& width, Vec3f& sum) {
+    size_t n_threads = std::max<size_t>(1, thread::hardware_concurrency());
+    vector<Vec3f> sums(n_threads, Vec3f::zeros);
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (size_t t = 0; t < n_threads; t++) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = t; i < uvs.size(); i += n_threads) {
+                sums[t] = sums[t] + tex.sample(Vec3f::zeros, uvs[i], width);
+            }
+        });
+    }
+    for (thread& t : threads) { t.join(); }
+    double rate = uvs.size() / seconds_since(start);
+    for (const Vec3f& s : sums) { sum = sum + s; }
+    return rate;
+}
+
+int main(void) {
+    // procedural image with fine details
+    vector<uint8_t> rgb(3 * n_texels * n_texels);
+    for (size_t y = 0; y < n_texels; y++) {
+        for (size_t x = 0; x < n_texels; x++) {
+            uint8_t* c = &rgb[3 * (y * n_texels + x)];
+            c[0] = ((x ^ y) & 8)? 220 : 20;
+            c[1] = (x * 255) / n_texels;
+            c[2] = (y * 255) / n_texels;
+        }
+    }
+    txr::Image img(n_texels, n_texels, rgb.data());
+    auto start = chrono::steady_clock::now();
+    if (!img.save_tiled(fpath)) { cout << "failed to write " << fpath << endl; return 1; }
+    cout << n_texels << "x" << n_texels << " texture written in " << seconds_since(start) * 1e3 << "ms" << endl;
+    // random positions in a window covering a quarter of the
+    // texture, the footprint of the samples spans two texels
+    vector<txr::TexCoord> uvs(n_samples);
+    for (txr::TexCoord& uv : uvs) { uv = { 0.5f * rng::randf(), 0.5f * rng::randf() }; }
+    float width = 2.0f / n_texels;
+    Vec3f sum = Vec3f::zeros;
+    cout << "  in memory: " << run(img, uvs, width, sum) / 1e6 << "M samples/s" << endl;
+    for (const int& budget_mb : { 4, 16, 64, 256 }) {
+        txr::TileCache cache((size_t)budget_mb << 20);
+        txr::TiledImage tiled(cache, fpath);
+        // the first pass loads the blocks and the
+        // second one runs on the warm cache
+        for (const char* pass : { "cold", "warm" }) {
+            txr::TileCacheStats before = cache.stats();
+            double rate = run(tiled, uvs, width, sum);
+            txr::TileCacheStats after = cache.stats();
+            cout << "  budget " << budget_mb << "MB " << pass << ": " << rate / 1e6 << "M samples/s, "
+                 << after.n_hits - before.n_hits << " hits, " << after.n_misses - before.n_misses << " misses, "
+                 << (after.n_bytes_read - before.n_bytes_read) / (1024.0 * 1024.0) << "MB read" << endl;
+        }
+    }
+    // keep the results alive
+    cout << "  (checksum " << sum[0] + sum[1] + sum[2] << ")" << endl;
+    remove(fpath);
+}
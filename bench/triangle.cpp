@@ -0,0 +1,137 @@
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include <rng.hpp>
+#include "../src/vec.hpp"
+#include "../src/mesh.hpp"
+#include "../src/primitive.hpp"
+
+using namespace std;
+
+// microbenchmark comparing the ray-triangle kernels by
+// their throughput on a mesh and by the number of rays
+// leaking through the shared edges of a closed box
+
+const size_t n_rays = 1 << 12;
+const size_t n_repeats = 8;
+const size_t n_edge_rays = 1 << 20;
+
+const TriangleKernel kernels[3] = {
+    TriangleKernel::MollerTrumbore,
+    TriangleKernel::Watertight,
+    TriangleKernel::Plane
+};
+const char* names[3] = { "moller-trumbore", "watertight", "plane" };
+
+// build a packet of four copies of a ray
+Ray4 broadcast(const Vec3f& o, const Vec3f& d) {
+    return {
+        { Vec4f(o[0]), Vec4f(o[1]), Vec4f(o[2]) },
+        { Vec4f(d[0]), Vec4f(d[1]), Vec4f(d[2]) }
+    };
+}
+
+// random point in the unit cube
+Vec3f rand_point(void) { return Vec3f(rng::randf(), rng::randf(), rng::randf()); }
+
+// collect all triangles of a mesh using the given kernel
+TriangleCollection collect(const Mesh& mesh, const TriangleKernel& kernel) {
+    TriangleCollection coll(kernel);
+    for (size_t t = 0; t < mesh.size(); t++) {
+        coll.push_back(mesh.vertex(t, 0), mesh.vertex(t, 1), mesh.vertex(t, 2), mesh.material(t));
+    }
+    coll.close_packet();
+    return coll;
+}
+
+void throughput(const Mesh& mesh) {
+    // rays starting on a box around the mesh
+    // and pointing to random points in its center
+    vector<Ray4> rays;
+    for (size_t i = 0; i < n_rays; i++) {
+        Vec3f o = rand_point() * 6.0f - 3.0f;
+        Vec3f p = rand_point() - 0.5f;
+        rays.push_back(broadcast(o, (p - o).normalize()));
+    }
+    // the hits of the first kernel are the reference
+    vector<float> reference(n_rays);
+    for (size_t k = 0; k < 3; k++) {
+        TriangleCollection coll = collect(mesh, kernels[k]);
+        size_t n_hits = 0, n_differ = 0;
+        auto start = chrono::steady_clock::now();
+        for (size_t r = 0; r < n_repeats; r++) {
+            for (size_t i = 0; i < n_rays; i++) {
+                Hit hit;
+                bool found = coll.cast(rays[i], 0, coll.n_packets(), hit);
+                if (r == 0) {
+                    // compare the hit distances
+                    float t = found? hit.t : -1.0f;
+                    if (k == 0) { reference[i] = t; }
+                    n_differ += (fabsf(reference[i] - t) > 1e-3f);
+                    n_hits += found;
+                }
+            }
+        }
+        auto stop = chrono::steady_clock::now();
+        double s = chrono::duration_cast<chrono::microseconds>(stop - start).count() / 1e6;
+        double rays_per_s = n_rays * n_repeats / s;
+        cout << "  " << names[k] << ": " << rays_per_s / 1e6 << "M rays/s, "
+             << rays_per_s * coll.n_primitives() / 1e9 << "G tests/s, "
+             << n_hits << " hits, " << n_differ << " differ" << endl;
+    }
+}
+
+// corners of the triangles forming the walls of the
+// cornell box, all of them share their edges
+const float walls[12][9] = {
+    { 0, 1, 0,  0, 1, -1,  1, 1, 0 }, { 1, 1, -1,  1, 1, 0,  0, 1, -1 },
+    { 0, 0, 0,  1, 0, 0,  0, 0, -1 }, { 1, 0, -1,  0, 0, -1,  1, 0, 0 },
+    { 0, 0, -1,  1, 0, -1,  0, 1, -1 }, { 1, 1, -1,  0, 1, -1,  1, 0, -1 },
+    { 1, 1, 0,  1, 0, 0,  0, 1, 0 }, { 0, 0, 0,  0, 1, 0,  1, 0, 0 },
+    { 0, 0, 0,  0, 0, -1,  0, 1, 0 }, { 0, 1, -1,  0, 1, 0,  0, 0, -1 },
+    { 1, 0, 0,  1, 1, 0,  1, 0, -1 }, { 1, 1, -1,  1, 0, -1,  1, 1, 0 }
+};
+
+void leaks(void) {
+    // build the closed box scaled
+    // as in the example scene
+    Mesh box;
+    for (size_t i = 0; i < 12; i++) {
+        const float* w = walls[i];
+        box.add_triangle(Vec3f(w[0], w[1], w[2]), Vec3f(w[3], w[4], w[5]), Vec3f(w[6], w[7], w[8]), nullptr);
+    }
+    box.scale(20.0f);
+    // rays from random points inside the box
+    // aimed at random points on the edges of its
+    // triangles, each of them has to hit a wall
+    vector<Ray4> rays;
+    for (size_t i = 0; i < n_edge_rays; i++) {
+        const float* w = walls[i % 12];
+        size_t e = (i / 12) % 3, f = (e + 1) % 3;
+        Vec3f a(w[3 * e], w[3 * e + 1], w[3 * e + 2]);
+        Vec3f b(w[3 * f], w[3 * f + 1], w[3 * f + 2]);
+        Vec3f p = (a + (b - a) * rng::randf()) * 20.0f;
+        Vec3f o = rand_point() * 16.0f + Vec3f(2.0f, 2.0f, -18.0f);
+        rays.push_back(broadcast(o, (p - o).normalize()));
+    }
+    for (size_t k = 0; k < 3; k++) {
+        TriangleCollection coll = collect(box, kernels[k]);
+        size_t n_misses = 0;
+        for (const Ray4& ray : rays) {
+            Hit hit;
+            n_misses += !coll.cast(ray, 0, coll.n_packets(), hit);
+        }
+        cout << "  " << names[k] << ": " << n_misses << " of "
+             << n_edge_rays << " rays leak" << endl;
+    }
+}
+
+int main(void) {
+    // the mesh to measure the throughput on
+    Mesh suzanne = Mesh::load_obj("obj/suzanne.obj", nullptr);
+    cout << "Throughput on " << suzanne.size() << " triangles" << endl;
+    throughput(suzanne);
+    // rays aimed at the edges of a closed box
+    cout << "Edge rays against the closed cornell box" << endl;
+    leaks();
+}
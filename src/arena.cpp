@@ -0,0 +1,83 @@
+#include "./arena.hpp"
+#include <cstdint>
+#include <cstdlib>
+
+Arena::Arena(const size_t& block_size) :
+    _block_size(block_size)
+{
+}
+
+Arena::Arena(Arena&& other) :
+    _block_size(other._block_size),
+    blocks(std::move(other.blocks)),
+    cur(other.cur),
+    end(other.end),
+    dtors(std::move(other.dtors)),
+    _n_bytes(other._n_bytes)
+{
+    // the other arena is left empty
+    other.blocks.clear();
+    other.dtors.clear();
+    other.cur = other.end = nullptr;
+    other._n_bytes = 0;
+}
+
+Arena& Arena::operator=(Arena&& other)
+{
+    if (this != &other) {
+        // release the own objects and
+        // take over the other ones
+        clear();
+        _block_size = other._block_size;
+        blocks.swap(other.blocks);
+        dtors.swap(other.dtors);
+        std::swap(cur, other.cur);
+        std::swap(end, other.end);
+        std::swap(_n_bytes, other._n_bytes);
+    }
+    return *this;
+}
+
+Arena::~Arena(void)
+{
+    clear();
+}
+
+void* Arena::allocate(
+    const size_t& size,
+    const size_t& align
+) {
+    // align the current position
+    uintptr_t p = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+    if ((cur == nullptr) || (p + size > (uintptr_t)end)) {
+        // start a new block which is large enough
+        // to hold the object including the alignment
+        size_t n = (size + align > _block_size)? size + align : _block_size;
+        char* block = (char*)std::malloc(n);
+        if (block == nullptr) { throw std::bad_alloc(); }
+        blocks.push_back(block);
+        cur = block;
+        end = block + n;
+        p = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+    }
+    // bump the current position
+    cur = (char*)(p + size);
+    _n_bytes += size;
+    return (void*)p;
+}
+
+void Arena::clear(void)
+{
+    // destroy the objects in reverse order
+    for (size_t i = dtors.size(); i > 0; i--) {
+        dtors[i - 1].second(dtors[i - 1].first);
+    }
+    dtors.clear();
+    // free all blocks at once
+    for (char* block : blocks) { std::free(block); }
+    blocks.clear();
+    cur = end = nullptr;
+    _n_bytes = 0;
+}
+
+const size_t& Arena::n_bytes(void) const { return _n_bytes; }
@@ -0,0 +1,61 @@
+#ifndef H_ARENA
+#define H_ARENA
+
+// includes
+#include <new>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+
+// bump allocator handing out memory from large blocks, all
+// objects created in the arena are destroyed and their
+// memory is released in bulk when the arena is destroyed
+class Arena {
+private:
+    // default size of a block of memory
+    size_t _block_size;
+    // all allocated blocks and the free
+    // range of the current block
+    std::vector<char*> blocks;
+    char* cur = nullptr;
+    char* end = nullptr;
+    // destructors of the objects that are not trivially
+    // destructible in the order of their construction
+    std::vector<std::pair<void*, void (*)(void*)>> dtors;
+    // number of bytes handed out
+    size_t _n_bytes = 0;
+public:
+    // constructors / destructor
+    Arena(const size_t& block_size = 1 << 16);
+    Arena(Arena&& other);
+    Arena& operator=(Arena&& other);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena(void);
+    // allocate uninitialized memory
+    void* allocate(const size_t& size, const size_t& align);
+    // construct an object in the arena
+    template<typename T, typename... Args>
+    T* create(Args&&... args);
+    // destroy all objects and free the memory
+    void clear(void);
+    // number of bytes allocated so far
+    const size_t& n_bytes(void) const;
+};
+
+template<typename T, typename... Args>
+T* Arena::create(Args&&... args)
+{
+    // construct the object in place
+    void* p = allocate(sizeof(T), alignof(T));
+    T* obj = new (p) T(std::forward<Args>(args)...);
+    // remember how to destroy the object
+    // unless there is nothing to do
+    if (!std::is_trivially_destructible<T>::value) {
+        dtors.push_back({ obj, [](void* q) { static_cast<T*>(q)->~T(); } });
+    }
+    return obj;
+}
+
+#endif // H_ARENA
@@ -0,0 +1,79 @@
+#ifndef H_BUFFER
+#define H_BUFFER
+
+// includes
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <immintrin.h>
+#include "./hugepages.hpp"
+
+// array that either owns its elements or refers to elements
+// in read-only memory owned by someone else, e.g. a memory
+// mapped file, elements can only be added to owned arrays,
+// large owned arrays are backed by huge pages
+template<typename T>
+class Buffer {
+private:
+    // the owned elements, empty for a view
+    HugeVector<T> items;
+    // the first element and the number of elements,
+    // points into the owned elements unless the
+    // buffer is a view
+    const T* ptr = nullptr;
+    size_t n = 0;
+    // point to the owned elements
+    void sync(void) { ptr = items.data(); n = items.size(); }
+public:
+    // constructors
+    Buffer(void) = default;
+    Buffer(HugeVector<T>&& values) : items(std::move(values)) { sync(); }
+    Buffer(const Buffer& other) : items(other.items) {
+        // a copy of a view refers to the same memory
+        if (other.is_view()) { ptr = other.ptr; n = other.n; } else { sync(); }
+    }
+    Buffer(Buffer&& other) : items(std::move(other.items)), ptr(other.ptr), n(other.n) {
+        other.ptr = nullptr;
+        other.n = 0;
+    }
+    Buffer& operator=(Buffer other) {
+        // copy and swap, the moved vector keeps
+        // its memory and thus the pointer stays valid
+        items.swap(other.items);
+        std::swap(ptr, other.ptr);
+        std::swap(n, other.n);
+        return *this;
+    }
+    // refer to the given elements instead
+    // of owning any elements
+    void view(const T* values, const size_t& count) {
+        HugeVector<T>().swap(items);
+        ptr = values;
+        n = count;
+    }
+    bool is_view(void) const { return (n > 0) && (ptr != items.data()); }
+    // copy the elements of a view into
+    // owned memory
+    void own(void) { if (is_view()) { items.assign(ptr, ptr + n); sync(); } }
+    // add elements to an owned buffer
+    void reserve(const size_t& count) { items.reserve(count); sync(); }
+    void push_back(const T& value) { items.push_back(value); sync(); }
+    void emplace_back(void) { items.emplace_back(); sync(); }
+    T& back(void) { return items.back(); }
+    // element access
+    size_t size(void) const { return n; }
+    const T* data(void) const { return ptr; }
+    const T& operator[](const size_t& i) const { return ptr[i]; }
+    const T* begin(void) const { return ptr; }
+    const T* end(void) const { return ptr + n; }
+    // hint the caches to load all cache lines of the
+    // i-th element, which may span one more line than
+    // its size suggests if it is not aligned to them
+    void prefetch(const size_t& i) const {
+        const char* p = reinterpret_cast<const char*>(ptr + i);
+        for (size_t off = 0; off < sizeof(T); off += 64) { _mm_prefetch(p + off, _MM_HINT_T0); }
+        _mm_prefetch(p + sizeof(T) - 1, _MM_HINT_T0);
+    }
+};
+
+#endif // H_BUFFER
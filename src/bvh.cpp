@@ -18,6 +18,9 @@ AABB::AABB(
 {
 }
 
+const Vec3f& AABB::lower(void) const { return low; }
+const Vec3f& AABB::upper(void) const { return high; }
+
 Vec3f AABB::center(void) const {
     return (low + high) * 0.5f;
 }
@@ -65,8 +68,10 @@ AABB4::AABB4(
 {
 }
 
-unsigned int AABB4::cast(const Ray4& ray) const
-{
+unsigned int AABB4::cast(
+    const Ray4& ray,
+    const Vec4f& tmax
+) const {
     Vec4f t0x = (low[0] - ray.origin[0]) / ray.direction[0];
     Vec4f t0y = (low[1] - ray.origin[1]) / ray.direction[1];
     Vec4f t0z = (low[2] - ray.origin[2]) / ray.direction[2];
@@ -81,7 +86,10 @@ unsigned int AABB4::cast(const Ray4& ray) const
     Vec4f maxz = t0z.max(t1z);
     Vec4f tmin_max = minx.max(miny.max(minz));
     Vec4f tmax_min = maxx.min(maxy.min(maxz));
-    return _mm_movemask_ps(tmin_max < tmax_min);
+    // make sure the box is neither behind
+    // the ray nor beyond its maximum distance
+    Vec4f mask = (tmin_max < tmax_min) & (Vec4f::zeros < tmax_min) & (tmin_max < tmax);
+    return _mm_movemask_ps(mask);
 }
 
 
@@ -90,43 +98,42 @@ unsigned int AABB4::cast(const Ray4& ray) const
  */
 
 BVH::BVH(
-    const BoundableList& objs,
+    const std::vector<AABB>& bounds,
     const size_t& max_depth,
     const size_t& min_size
 ) {
-    // compute the depth of the tree
-    depth = ceil(log2f((float)objs.size()) / log2f(4.0f));
+    // compute the maximum depth of the tree
+    size_t depth = ceil(log2f((float)bounds.size()) / log2f(4.0f));
     depth = (depth > max_depth)? max_depth : depth;
-    // compute the number of inner and total nodes
-    n_inner_nodes = pow(4, depth) - 1;
-    n_total_nodes = pow(4, depth+1) - 1;
     // the number of leaf nodes is initially
     // set to zero but incremented whenever
     // a leaf node is created
     n_leaf_nodes = 0;
-    // allocate memory for the binary tree
-    tree = new bvh_node[n_total_nodes];
-    // allocate memory to store
-    //  - the primitive assignment of inner nodes
-    //  - if the node is a valid inner node
-    BoundableList tmp_objs_assign[n_inner_nodes];
-    bool valid_inner[n_inner_nodes];
-    
+    // the nodes are appended while the tree is
+    // built starting with the root node
+    HugeVector<BVHNode> nodes(1);
+    // all primitives are initially assigned to the
+    // root, each node is assigned to a range of the
+    // ids which is partitioned in-place when the
+    // node is split up into its children
+    prim_ids.resize(bounds.size());
+    std::iota(prim_ids.begin(), prim_ids.end(), 0);
+    // queue of inner nodes that still need to be
+    // split up together with their id ranges
+    struct split_task { size_t i, begin, end, level; };
+    std::queue<split_task> q;
+
     // helper function to set the value of
     // a node during construction of the tree
-    auto set_node = [this, &tmp_objs_assign, &valid_inner, &min_size](
+    auto set_node = [this, &bounds, &q, &nodes, &depth, &min_size](
         const size_t& i,
-        const BoundableList::const_iterator& begin,
-        const BoundableList::const_iterator& end
+        const size_t& begin,
+        const size_t& end,
+        const size_t& level
     ) -> AABB {
-        // initially mark the current node as invalid
-        // provided that it is not in the last layer
-        // this will be overriden if the node
-        // turns out to be an inner node
-        if (i < n_inner_nodes) { valid_inner[i] = false; }
         // get the number of elements stored
         // in the subtree of the current node
-        size_t d = std::distance(begin, end);
+        size_t d = end - begin;
         // make sure the subtree rooted at i
         // stores at least one primitive
         // this is only violated if the initial
@@ -135,37 +142,35 @@ BVH::BVH(
         if (d == 0) {
             // note that in this case the node
             // is a leaf node with invalid id
-            tree[i].is_leaf = true;
-            tree[i].leaf_id = (size_t)-1;
+            nodes[i].is_leaf = true;
+            nodes[i].leaf_id = (uint32_t)-1;
+            nodes[i].child = 0;
             return AABB();
         }
-        // create a vector storing the
-        // triangles in the given iterator
-        BoundableList node_objs(begin, end);
         // check if the node is a leaf node, i.e.
         //  - the node is at maximum depth or
         //  - the minumum number of primitives would be 
         //    violated by splitting the node again
-        if ((i >= n_inner_nodes) || (d < min_size * 4)) {
+        if ((level >= depth) || (d < min_size * 4)) {
             // set the node of the tree to be a leaf node
-            tree[i].is_leaf = true;
-            tree[i].leaf_id = n_leaf_nodes++;
-            // push the boundable list of the leaf node
-            leaf_objs.push_back(node_objs);
+            nodes[i].is_leaf = true;
+            nodes[i].leaf_id = n_leaf_nodes++;
+            nodes[i].child = 0;
+            // remember the id range of the leaf node
+            leaf_ranges.push_back({ begin, end });
         } else {
             // if none of the above statements hold true
             // then the current node is an inner node
-            tree[i].is_leaf = false;
-            tree[i].leaf_id = (size_t)-1;
-            tmp_objs_assign[i] = node_objs;
-            valid_inner[i] = true;
-		}
+            nodes[i].is_leaf = false;
+            nodes[i].leaf_id = (uint32_t)-1;
+            q.push({ i, begin, end, level });
+        }
         // build the axis aligned bounding box
-        // that contains all triangles assigned
+        // that contains all primitives assigned
         // to the current node i
-        AABB aabb = node_objs[0]->bound();
-        for (const Boundable* t : node_objs) {
-            AABB tmp = t->bound();
+        AABB aabb = bounds[prim_ids[begin]];
+        for (size_t k = begin; k < end; k++) {
+            const AABB& tmp = bounds[prim_ids[k]];
             aabb.low = aabb.low.min(tmp.low);
             aabb.high = aabb.high.max(tmp.high);
         }
@@ -173,32 +178,29 @@ BVH::BVH(
     };
 
     // set root of the tree
-    set_node(0, objs.begin(), objs.end());
-    // build binary tree in top-down fashion
-    // starting at the root and splitting it up
-    for (size_t i = 0; i < n_inner_nodes; i++) {
-
-        // make sure the current node is a valid 
-        // inner node, i.e. it is not in the 
-        // subtree rooted at a node that was 
-        // previously declared to be a leaf node 
-        // (see set_node function)
-        if (!valid_inner[i]) { continue; }
-        
-        // get the list of triangles assigned
-        // to the current inner node
-        BoundableList node_objs = tmp_objs_assign[i];
-        
-        // collect the center points of all
-        // primitves in the current node
-        std::vector<Vec3f> vecs; vecs.reserve(node_objs.size());
-        for (const Boundable* p : node_objs)
-            vecs.push_back(p->bound().center());
-        // compute their variance for each dimension
-        Vec3f inv = Vec3f(1.0f / vecs.size());
-        Vec3f mean = std::accumulate(vecs.begin(), vecs.end(), Vec3f::zeros) * inv;
-        for (Vec3f& v : vecs) { v = v - mean; v = v * v; }
-        Vec3f var = std::accumulate(vecs.begin(), vecs.end(), Vec3f::zeros) * inv;
+    root_aabb = set_node(0, 0, prim_ids.size(), 0);
+    // build the tree in top-down fashion starting at
+    // the root and splitting it up, note that the queue
+    // processes the nodes in the order of their index
+    // and thus the nodes are stored level by level
+    while (!q.empty()) {
+        // get the next inner node and the range
+        // of primitives assigned to it
+        split_task task = q.front(); q.pop();
+        float inv = 1.0f / (task.end - task.begin);
+        // compute the variance of the center points of
+        // all primitives in the node for each dimension
+        Vec3f mean = Vec3f::zeros;
+        for (size_t k = task.begin; k < task.end; k++) {
+            mean = mean + bounds[prim_ids[k]].center();
+        }
+        mean = mean * inv;
+        Vec3f var = Vec3f::zeros;
+        for (size_t k = task.begin; k < task.end; k++) {
+            Vec3f v = bounds[prim_ids[k]].center() - mean;
+            var = var + v * v;
+        }
+        var = var * inv;
         // choose dimension with maximum variance
         // as the split axis for the current node
         float x = var[0], y = var[1], z = var[2];
@@ -206,59 +208,83 @@ BVH::BVH(
                     ( (z > x)? 2 : 0 ) : 
                     ( (z > y)? 2 : 1 ) ;
         // create comparator for choosen axis
-        auto comp = [&axis](
-            const Boundable* a, 
-            const Boundable* b
+        auto comp = [&bounds, &axis](
+            const uint32_t& a, 
+            const uint32_t& b
         ) -> bool {
-            return a->bound().center()[axis] < b->bound().center()[axis]; 
+            return bounds[a].center()[axis] < bounds[b].center()[axis]; 
         };
         // find median along choosen axis
-        BoundableList::iterator begin = node_objs.begin();
-        BoundableList::iterator splitA = begin + node_objs.size() / 4;
-        BoundableList::iterator median = begin + node_objs.size() / 2;
-        BoundableList::iterator splitB = median + node_objs.size() / 4;
-        BoundableList::iterator end = node_objs.end();
-        std::nth_element(begin, median, end, comp);
-        std::nth_element(begin, splitA, median, comp);
-        std::nth_element(median, splitB, end, comp);
+        size_t n = task.end - task.begin;
+        size_t splitA = task.begin + n / 4;
+        size_t median = task.begin + n / 2;
+        size_t splitB = median + n / 4;
+        std::vector<uint32_t>::iterator ids = prim_ids.begin();
+        std::nth_element(ids + task.begin, ids + median, ids + task.end, comp);
+        std::nth_element(ids + task.begin, ids + splitA, ids + median, comp);
+        std::nth_element(ids + median, ids + splitB, ids + task.end, comp);
         // build children nodes by splitting the
-        // primitive list at the median
-        tree[i].aabb4 = AABB4(
-            set_node(4 * i + 1, begin, splitA),
-            set_node(4 * i + 2, splitA, median),
-            set_node(4 * i + 3, median, splitB),
-            set_node(4 * i + 4, splitB, end)
+        // primitive range at the median, the
+        // children are appended to the nodes
+        size_t c = nodes.size(), l = task.level + 1;
+        nodes.resize(c + 4);
+        nodes[task.i].child = c;
+        AABB4 aabb4(
+            set_node(c + 0, task.begin, splitA, l),
+            set_node(c + 1, splitA, median, l),
+            set_node(c + 2, median, splitB, l),
+            set_node(c + 3, splitB, task.end, l)
         );
+        nodes[task.i].aabb4 = aabb4;
     }
+    // the tree owns the nodes from now on
+    tree = Buffer<BVHNode>(std::move(nodes));
 }
 
-BVH::~BVH(void)
+BVH::BVH(
+    const BVHNode* nodes,
+    const size_t& n_nodes,
+    const size_t& n_leafs,
+    const AABB& bounds
+) :
+    root_aabb(bounds),
+    n_leaf_nodes(n_leafs)
 {
-    // free the memory allocated
-    // to store the tree
-    delete[] tree;
+    // the nodes are not copied
+    tree.view(nodes, n_nodes);
 }
 
-const BoundableList& BVH::get_leaf_objects(const size_t& leaf_id) const
+PrimitiveRange BVH::get_leaf_primitives(const size_t& leaf_id) const
 {
-    // return a pointer to the primitive
+    // return the range of the primitive ids
     // of the given leaf referenced by id
-    return leaf_objs[leaf_id];
+    const std::pair<size_t, size_t>& range = leaf_ranges[leaf_id];
+    return { prim_ids.data() + range.first, prim_ids.data() + range.second };
 }
 
 void BVH::sort_rays_by_leafs(
-    const RayQueue& rays,
-    std::vector<RayQueue>& sorted
+    const RayStream& rays,
+    LeafSortBuffer& buffer,
+    RayStream& sorted,
+    const bool& prefetch
 ) const {
+    // make sure there is a counter and
+    // a ray stamp for each leaf
+    if (buffer.offsets.size() < n_leaf_nodes) {
+        buffer.offsets.resize(n_leaf_nodes, 0);
+    }
+    if (buffer.last_rays.size() < n_leaf_nodes) {
+        buffer.last_rays.resize(n_leaf_nodes, 0);
+    }
     // create a queue to hold all inner nodes
     // that need to be checked during traversal
     std::queue<size_t> q;
-    for (const Ray& ray : rays) {
+    // first pass: traverse the tree with each ray
+    // and count the (ray, leaf) pairs
+    for (size_t r = 0; r < rays.size(); r++) {
         // build ray packet from ray
-        Ray4 ray_packet = {
-            { Vec4f(ray.origin[0]), Vec4f(ray.origin[1]), Vec4f(ray.origin[2]) },
-            { Vec4f(ray.direction[0]), Vec4f(ray.direction[1]), Vec4f(ray.direction[2]) }
-        };
+        Ray4 ray_packet = rays.broadcast(r);
+        Vec4f tmax(rays.tmax[r]);
         // start with the leaf node
         q.push(0);
         // traverse the tree
@@ -266,27 +292,63 @@ void BVH::sort_rays_by_leafs(
             // get the next node to process
             // and remove it from the queue
             size_t i = q.front(); q.pop();
-            bvh_node node = tree[i];
+            const BVHNode& node = tree[i];
             // check if the node is a valid leaf
-            if (node.is_leaf && (node.leaf_id < (size_t)-1)) {
-                // push the ray into the queue
-                // that corresponds to the leaf node
-                sorted[node.leaf_id].push_back(ray);
+            if (node.is_leaf && (node.leaf_id < (uint32_t)-1)) {
+                // check if the previous ray visited the
+                // leaf as well to track leaf coherence
+                if ((r > 0) && (buffer.last_rays[node.leaf_id] == r)) { buffer.n_leaf_hits++; }
+                buffer.last_rays[node.leaf_id] = r + 1;
+                // remember the pair and count it, the
+                // first ray of a leaf marks it as touched
+                buffer.pairs.push_back({ (uint32_t)node.leaf_id, (uint32_t)r });
+                if (buffer.offsets[node.leaf_id]++ == 0) {
+                    buffer.touched.push_back(node.leaf_id);
+                }
                 continue;
             }
             // cast the ray to the bounding box packet
-            unsigned int mask = node.aabb4.cast(ray_packet);
+            unsigned int mask = node.aabb4.cast(ray_packet, tmax);
             // for each box that intersect with
             // the ray add the corresponding child
-            // to the queue
+            // to the queue, the children are only
+            // visited after the nodes queued before
+            // which leaves time to load them
             for (size_t j = 0; j < 4; j++) {
                 // check if the box intersects with the ray
-                if (mask & 1u) { q.push(4 * i + j + 1); }
+                if (mask & 1u) {
+                    if (prefetch) { tree.prefetch(node.child + j); }
+                    q.push(node.child + j);
+                }
                 // go on with the next box
                 mask >>= 1;
             }
         }
     }
+    buffer.n_leaf_visits += buffer.pairs.size();
+    // turn the counts of the touched leafs
+    // into offsets into the flat array
+    size_t offset = 0;
+    for (const uint32_t& leaf_id : buffer.touched) {
+        size_t count = buffer.offsets[leaf_id];
+        buffer.ranges.push_back({ leaf_id, offset, offset + count });
+        buffer.offsets[leaf_id] = offset;
+        offset += count;
+    }
+    // second pass: scatter the rays into
+    // the ranges of their leafs
+    sorted.resize(buffer.pairs.size());
+    for (const std::pair<uint32_t, uint32_t>& pair : buffer.pairs) {
+        sorted.set(buffer.offsets[pair.first]++, rays, pair.second);
+    }
+    // reset the offsets and stamps of the touched
+    // leafs and clear the pairs for the next sort
+    for (const uint32_t& leaf_id : buffer.touched) {
+        buffer.offsets[leaf_id] = 0;
+        buffer.last_rays[leaf_id] = 0;
+    }
+    buffer.pairs.clear();
+    buffer.touched.clear();
 }
 
 const size_t& BVH::num_leafs(void) const {
@@ -295,3 +357,6 @@ const size_t& BVH::num_leafs(void) const {
     return n_leaf_nodes;
 }
 
+const AABB& BVH::bounds(void) const { return root_aabb; }
+size_t BVH::num_nodes(void) const { return tree.size(); }
+
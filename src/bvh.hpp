@@ -4,13 +4,16 @@
 // forward declarations
 struct Ray;
 struct Ray4;
-class RayQueue;
+class RayStream;
 class BVH;
 class AABB4;
+class Scene;
 // includes
 #include <array>
 #include <vector>
+#include <cstdint>
 #include "./vec.hpp"
+#include "./buffer.hpp"
 
 /*
  *  Axis-Aligned Bounding Box
@@ -31,7 +34,10 @@ public:
         const Vec3f& A,
         const Vec3f& B
     );
-    // get the center of the bounding box
+    // get the corners and the center
+    // of the bounding box
+    const Vec3f& lower(void) const;
+    const Vec3f& upper(void) const;
     Vec3f center(void) const;
     // cast a ray to the bounding box
     bool cast(const Ray& r) const;
@@ -54,9 +60,13 @@ public:
         const AABB& C,
         const AABB& D
     );
-    // cast a ray to the bounding boxes
-    // and return a bit-level mask
-    unsigned int cast(const Ray4& r) const;
+    // cast a ray to the bounding boxes and return
+    // a bit-level mask of the boxes that are hit
+    // within the distance range (0, tmax]
+    unsigned int cast(
+        const Ray4& r,
+        const Vec4f& tmax
+    ) const;
 };
 
 
@@ -77,47 +87,116 @@ public:
 // shortcut for list of boundables
 using BoundableList = std::vector<Boundable*>;
 
+// range of the ids of the primitives
+// assigned to a leaf node
+typedef struct PrimitiveRange {
+    const uint32_t* first;
+    const uint32_t* last;
+    // allow range-based loops
+    const uint32_t* begin(void) const { return first; }
+    const uint32_t* end(void) const { return last; }
+    size_t size(void) const { return last - first; }
+} PrimitiveRange;
+
+// range of the flat array of sorted rays
+// holding all rays of a single leaf node
+typedef struct LeafRange {
+    size_t leaf_id;
+    size_t begin, end;
+} LeafRange;
+
+// scratch memory of the two-pass counting
+// sort of rays into the leafs of the hierarchy
+typedef struct LeafSortBuffer {
+    // (leaf id, ray index) pairs found
+    // while traversing the hierarchy
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    // per-leaf ray counts that are turned into
+    // offsets during the scatter pass, only the
+    // entries of touched leafs are non-zero
+    std::vector<uint32_t> offsets;
+    // per-leaf index plus one of the last ray that
+    // visited the leaf, zero for untouched leafs
+    std::vector<uint32_t> last_rays;
+    // ids of all leafs that are
+    // hit by at least one ray
+    std::vector<uint32_t> touched;
+    // the resulting ranges of
+    // the touched leafs
+    std::vector<LeafRange> ranges;
+    // number of (ray, leaf) pairs and the number
+    // of pairs whose leaf was also visited by the
+    // previous ray, i.e. was likely still cached
+    size_t n_leaf_visits = 0;
+    size_t n_leaf_hits = 0;
+} LeafSortBuffer;
+
+
+// node of the bounding volume hierarchy, the four
+// children of an inner node are stored next to each
+// other such that only the first one is referenced
+typedef struct BVHNode {
+    AABB4 aabb4;        // bounding boxes of the child nodes
+    uint32_t is_leaf;   // is the node a leaf node
+    uint32_t leaf_id;   // the id assigned to the leaf
+    uint32_t child;     // index of the first child node
+} BVHNode;
 
 class BVH {
 private:
-    // struct defining a node of
-    // the bvh tree
-    struct bvh_node {
-        AABB4 aabb4;    // bounding boxes of the child nodes
-        bool is_leaf;   // is the node a leaf node
-        size_t leaf_id; // the id assigned to the leaf
-    };
-    // collection of vectors of boundables where
-    // each vector collection corresponds to a
-    // leaf of the bounding volume hierarchy
-    std::vector<BoundableList> leaf_objs;
-    // basic tree information
-    size_t depth;
+    // ids of all primitives ordered such that
+    // the primitives of each leaf are contiguous
+    std::vector<uint32_t> prim_ids;
+    // the range of each leaf in the ids above
+    std::vector<std::pair<size_t, size_t>> leaf_ranges;
+    // bounding box of all objects
+    AABB root_aabb;
+    // number of leaf nodes in the tree
     size_t n_leaf_nodes;
-    size_t n_inner_nodes;
-    size_t n_total_nodes;
-    // memory to store the nodes of the tree
-    bvh_node* tree;
+    // the nodes of the tree starting with the root,
+    // only nodes that were actually created are stored
+    Buffer<BVHNode> tree;
+    // allow the scene to store the
+    // nodes in a snapshot
+    friend Scene;
 public:
     // constructor and destructor
     BVH(
-        const BoundableList& objs,          // objects to sort in the bvh
+        const std::vector<AABB>& bounds,    // bounding boxes of the primitives to sort in the bvh
         const size_t& max_depth,            // maximum depth of the bvh
         const size_t& min_size              // minimum number of primitives per leaf
     );
-    ~BVH(void);
-    // get the boundable list corresponding
-    // the the leaf node with given id
-    const BoundableList& get_leaf_objects(const size_t& leaf_id) const;
-    // sort rays into buckets where each
-    // bucket corresponds to one leaf
+    // refer to the nodes of a tree that was built before, e.g.
+    // stored in a memory mapped snapshot, the primitive ids of
+    // the leafs are not available for such a tree
+    BVH(
+        const BVHNode* nodes,
+        const size_t& n_nodes,
+        const size_t& n_leafs,
+        const AABB& bounds
+    );
+    // get the ids of the primitives assigned to the leaf node
+    // with given id, the ids index the bounding boxes that
+    // were passed to the constructor
+    PrimitiveRange get_leaf_primitives(const size_t& leaf_id) const;
+    // sort rays into a single flat array grouped
+    // by the leafs they intersect, the ranges of
+    // the leafs are stored in the sort buffer,
+    // optionally the children of the nodes are
+    // prefetched as soon as their boxes are hit
     void sort_rays_by_leafs(
-        const RayQueue& rays,
-        std::vector<RayQueue>& sorted
+        const RayStream& rays,
+        LeafSortBuffer& buffer,
+        RayStream& sorted,
+        const bool& prefetch = true
     ) const;
     // get the number of leaf nodes in
     // the bounding volume hierarchy
     const size_t& num_leafs(void) const;
+    // get the bounding box of the whole scene
+    const AABB& bounds(void) const;
+    // get the number of nodes in the tree
+    size_t num_nodes(void) const;
 };
 
 #endif // H_BVH
@@ -0,0 +1,218 @@
+#include "./context.hpp"
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/sysinfo.h>
+
+// helper function parsing a list of cpus
+// as used by sysfs, e.g. "0-3,8,10-11"
+static std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) { end = list.size(); }
+        std::string range = list.substr(pos, end - pos);
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = (dash == std::string::npos)? first : std::stoi(range.substr(dash + 1));
+            for (int c = first; c <= last; c++) { cpus.push_back(c); }
+        } catch (const std::exception&) {}
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+// helper function getting the cpus the
+// process is allowed to run on
+static std::vector<int> usable_cpus(void) {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; c++) {
+            if (CPU_ISSET(c, &set)) { cpus.push_back(c); }
+        }
+    }
+    if (cpus.empty()) { cpus.push_back(0); }
+    return cpus;
+}
+
+/*
+ *  Numa Topology
+ */
+
+NumaTopology NumaTopology::detect(void) {
+    std::vector<int> usable = usable_cpus();
+    NumaTopology topology;
+    // the nodes are numbered consecutively,
+    // stop at the first one that is missing
+    for (int node = 0; ; node++) {
+        std::ifstream f("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!f) { break; }
+        std::string list;
+        std::getline(f, list);
+        // keep the cpus the process may use
+        std::vector<int> cpus;
+        for (const int& c : parse_cpu_list(list)) {
+            if (std::find(usable.begin(), usable.end(), c) != usable.end()) { cpus.push_back(c); }
+        }
+        if (cpus.empty()) { continue; }
+        topology.cpus.push_back(cpus);
+        topology.ids.push_back(node);
+    }
+    // a single node without numa support
+    if (topology.cpus.empty()) {
+        topology.cpus.push_back(usable);
+        topology.ids.push_back(-1);
+    }
+    return topology;
+}
+
+NumaTopology NumaTopology::simulated(const size_t& n_nodes) {
+    std::vector<int> usable = usable_cpus();
+    NumaTopology topology;
+    size_t n = std::max<size_t>(1, n_nodes);
+    topology.cpus.resize(n);
+    topology.ids.assign(n, -1);
+    // split the cpus into consecutive blocks
+    // like the nodes of a real machine
+    size_t n_cpus = std::max(n, usable.size());
+    for (size_t c = 0; c < n_cpus; c++) {
+        topology.cpus[c * n / n_cpus].push_back(usable[c % usable.size()]);
+    }
+    return topology;
+}
+
+size_t NumaTopology::n_nodes(void) const { return cpus.size(); }
+
+size_t NumaTopology::free_memory(const size_t& node) const {
+    // read the free memory of an actual node, the
+    // line reads "Node <id> MemFree: <n> kB"
+    if (ids[node] >= 0) {
+        std::ifstream f("/sys/devices/system/node/node" + std::to_string(ids[node]) + "/meminfo");
+        std::string line;
+        while (std::getline(f, line)) {
+            size_t pos = line.find("MemFree:");
+            if (pos == std::string::npos) { continue; }
+            try { return std::stoull(line.substr(pos + 8)) * 1024; } catch (const std::exception&) { break; }
+        }
+    }
+    // share of the free memory of the machine
+    struct sysinfo info;
+    if (sysinfo(&info) != 0) { return 0; }
+    return (size_t)info.freeram * info.mem_unit / n_nodes();
+}
+
+
+/*
+ *  Render Context
+ */
+
+RenderContext::RenderContext(const size_t& n_workers) :
+    RenderContext(NumaTopology::simulated(1), false, (n_workers > 0)? n_workers : std::thread::hardware_concurrency())
+{
+}
+
+RenderContext::RenderContext(
+    const NumaTopology& topology,
+    const bool& pinning,
+    const size_t& n_workers
+) :
+    _topology(topology),
+    queues(topology.n_nodes()),
+    _n_stolen(0),
+    _replication(false)
+{
+    // take the cpus of all nodes in turns, such that
+    // fewer workers than cpus spread over all nodes
+    size_t max_cpus = 0;
+    for (const std::vector<int>& cpus : topology.cpus) { max_cpus = std::max(max_cpus, cpus.size()); }
+    std::vector<std::pair<size_t, int>> slots;
+    for (size_t k = 0; k < max_cpus; k++) {
+        for (size_t node = 0; node < topology.n_nodes(); node++) {
+            if (k < topology.cpus[node].size()) { slots.push_back({ node, topology.cpus[node][k] }); }
+        }
+    }
+    size_t n = (n_workers > 0)? n_workers : slots.size();
+    // the render args are sized by the
+    // first task that uses them
+    for (size_t i = 0; i < n; i++) {
+        scratch.emplace_back(new RenderArgs());
+        scratch.back()->node = slots[i % slots.size()].first;
+    }
+    for (size_t i = 0; i < n; i++) {
+        int cpu = slots[i % slots.size()].second;
+        workers.emplace_back([this, i, cpu, pinning] {
+            // pin the worker before it touches any memory
+            // such that its buffers are placed on its node,
+            // the worker runs unpinned if that fails
+            if (pinning) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            }
+            RenderArgs& args = *scratch[i];
+            for (;;) {
+                Task task;
+                {
+                    std::unique_lock<std::mutex> lock(queue_mutex);
+                    condition.wait(lock, [this] { return stop || (n_queued > 0); });
+                    if (stop && (n_queued == 0)) { return; }
+                    // take the tasks of the own node first
+                    // and those of the other nodes after
+                    size_t q = args.node;
+                    while (queues[q].empty()) { q = (q + 1) % queues.size(); }
+                    if (q != args.node) { _n_stolen++; }
+                    task = std::move(queues[q].front());
+                    queues[q].pop_front();
+                    n_queued--;
+                }
+                task(args);
+            }
+        });
+    }
+}
+
+RenderContext::~RenderContext(void) {
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        stop = true;
+    }
+    condition.notify_all();
+    for (std::thread& worker : workers) { worker.join(); }
+}
+
+// getters
+const NumaTopology& RenderContext::topology(void) const { return _topology; }
+size_t RenderContext::n_workers(void) const { return workers.size(); }
+size_t RenderContext::n_stolen(void) const { return _n_stolen; }
+bool RenderContext::replication(void) const { return _replication; }
+// setters
+void RenderContext::replication(const bool& new_replication) { _replication = new_replication; }
+
+std::future<void> RenderContext::submit(
+    const Task& task,
+    const size_t& node
+) {
+    // wrap the task to get notified
+    // once it is done
+    auto packaged = std::make_shared<std::packaged_task<void(RenderArgs&)>>(task);
+    std::future<void> done = packaged->get_future();
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queues[node % queues.size()].emplace_back([packaged](RenderArgs& args) { (*packaged)(args); });
+        n_queued++;
+    }
+    condition.notify_one();
+    return done;
+}
+
+RenderContext& RenderContext::global(void) {
+    static RenderContext context;
+    return context;
+}
@@ -0,0 +1,113 @@
+#ifndef H_CONTEXT
+#define H_CONTEXT
+
+// includes
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <future>
+#include <functional>
+#include <condition_variable>
+#include "./renderer.hpp"
+
+// the numa nodes of the machine and the cpus of each
+typedef struct NumaTopology {
+    // the cpus of each node and the id of each node
+    // in the system, -1 for nodes of a simulated
+    // topology that do not exist
+    std::vector<std::vector<int>> cpus;
+    std::vector<int> ids;
+    // read the topology of the machine from sysfs, a
+    // single node holding all usable cpus if it is not
+    // available, nodes without cpus are left out
+    static NumaTopology detect(void);
+    // split the usable cpus into the given number of
+    // nodes, nodes share cpus if there are fewer cpus
+    // than nodes, this allows testing the placement
+    // on machines with a single node
+    static NumaTopology simulated(const size_t& n_nodes);
+    // get the number of nodes
+    size_t n_nodes(void) const;
+    // get the free memory of a node in bytes, a node
+    // of a simulated topology gets its share of the
+    // free memory of the machine
+    size_t free_memory(const size_t& node) const;
+} NumaTopology;
+
+// long-lived set of render workers shared by any number of
+// renderers and scenes, each worker owns the render args it
+// passes to the tasks it runs, which are resized by the tasks
+// to the stream size and scene of their job, such that batch
+// jobs of many frames neither start threads nor allocate the
+// buffers of the paths for every frame
+//
+// the workers are spread over the nodes of a numa topology,
+// each node has its own queue of tasks and its workers only
+// take tasks of other nodes once their own queue is empty,
+// optionally each worker is pinned to a cpu of its node and
+// the renderers use a replica of their scene per node
+class RenderContext {
+private:
+    // a task gets the render args of the worker running it
+    using Task = std::function<void(RenderArgs&)>;
+    // the topology the workers are spread over
+    NumaTopology _topology;
+    // the workers and the render args of each, the
+    // args know the node of their worker
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<RenderArgs>> scratch;
+    // the task queue of each node and the
+    // total number of queued tasks
+    std::vector<std::deque<Task>> queues;
+    size_t n_queued = 0;
+    // number of tasks run by a
+    // worker of another node
+    std::atomic<size_t> _n_stolen;
+    // use a replica of the scene per node
+    std::atomic<bool> _replication;
+    // synchronization
+    std::mutex queue_mutex;
+    std::condition_variable condition;
+    bool stop = false;
+public:
+    // constructor starting the given number of workers on a
+    // single node, zero uses one worker per hardware thread
+    RenderContext(const size_t& n_workers = 0);
+    // constructor starting the given number of workers spread
+    // over the nodes of the topology, zero uses one worker per
+    // cpu, pinned workers only run on a single cpu of their node
+    RenderContext(
+        const NumaTopology& topology,
+        const bool& pinning,
+        const size_t& n_workers = 0
+    );
+    // the destructor runs all remaining
+    // tasks and joins the workers
+    ~RenderContext(void);
+    // the context is bound to its workers
+    RenderContext(const RenderContext&) = delete;
+    RenderContext& operator=(const RenderContext&) = delete;
+    // getters & setters
+    const NumaTopology& topology(void) const;
+    size_t n_workers(void) const;
+    size_t n_stolen(void) const;
+    bool replication(void) const;
+    // replicate the scenes of the renderers once per
+    // node, each replica is only built if it takes at
+    // most half of the free memory of its node
+    void replication(const bool& new_replication);
+    // add a task to the queue of the given node, the
+    // future is ready once the task was run
+    std::future<void> submit(
+        const Task& task,
+        const size_t& node = 0
+    );
+    // the context used by renderers that
+    // were not given one, created on first use
+    static RenderContext& global(void);
+};
+
+#endif // H_CONTEXT
@@ -48,6 +48,14 @@ void FrameBuffer::set_pixel(
     data[idx + 2] = b;
 }
 
+const unsigned char* FrameBuffer::pixel(
+    const size_t& i,
+    const size_t& j
+) const {
+    // point to the values of the pixel
+    return data + ravel_index(i, j, _height, _width);
+}
+
 
 int FrameBuffer::save_to_bmp(
     const char* fname
@@ -20,6 +20,11 @@ public:
         const unsigned char& g, 
         const unsigned char& b
     );
+    // get the (r, g, b) values of a pixel
+    const unsigned char* pixel(
+        const size_t& i,
+        const size_t& j
+    ) const;
     // getters
     const size_t& width(void) const { return _width; }
     const size_t& height(void) const { return _height; }
@@ -0,0 +1,50 @@
+#include "./hugepages.hpp"
+#include <atomic>
+#include <cstdint>
+#include <sys/mman.h>
+
+// huge pages are used unless disabled
+static std::atomic<bool> enabled(true);
+
+// helper function rounding the size of a
+// mapping up to whole huge pages
+inline size_t round_up(const size_t& n_bytes) {
+    return (n_bytes + huge_page_size - 1) & ~(huge_page_size - 1);
+}
+
+bool huge_pages(void) { return enabled; }
+void huge_pages(const bool& new_enabled) { enabled = new_enabled; }
+
+void* huge_alloc(const size_t& n_bytes, const size_t& alignment) {
+    // small arrays would waste most of a huge page, the
+    // mappings below are aligned to a huge page anyway
+    if (n_bytes < huge_page_size) { return ::operator new(n_bytes, std::align_val_t(alignment)); }
+    size_t n = round_up(n_bytes);
+    void* ptr = MAP_FAILED;
+    // take the pages from the pool reserved by the
+    // administrator, which usually is empty
+    if (enabled) {
+        ptr = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) { return ptr; }
+    }
+    // map one more huge page and cut off both ends such that
+    // the mapping starts at a huge page boundary, otherwise
+    // the kernel cannot back its first pages by a huge page
+    char* base = static_cast<char*>(mmap(nullptr, n + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED) { throw std::bad_alloc(); }
+    char* aligned = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(base)));
+    if (aligned > base) { munmap(base, aligned - base); }
+    munmap(aligned + n, base + huge_page_size - aligned);
+    // ask for transparent huge pages, which only takes
+    // effect if they are not disabled for the system,
+    // and explicitly opt out if huge pages are disabled
+    madvise(aligned, n, enabled? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+    return aligned;
+}
+
+void huge_free(void* ptr, const size_t& n_bytes, const size_t& alignment) {
+    // the size tells how the memory was allocated
+    if (ptr == nullptr) { return; }
+    if (n_bytes < huge_page_size) { ::operator delete(ptr, std::align_val_t(alignment)); return; }
+    munmap(ptr, round_up(n_bytes));
+}
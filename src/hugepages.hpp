@@ -0,0 +1,55 @@
+#ifndef H_HUGEPAGES
+#define H_HUGEPAGES
+
+// includes
+#include <new>
+#include <vector>
+#include <cstddef>
+
+// size of a huge page, allocations of at least this
+// size are placed in their own 2MB aligned mapping
+constexpr size_t huge_page_size = (size_t)2 << 20;
+
+// allocate and release memory for large arrays, allocations
+// of at least a huge page are mapped such that they can be
+// backed by huge pages, which lets a single tlb entry cover
+// 512 times more memory, the explicit huge page pool is tried
+// first and transparent huge pages are requested for the
+// mapping if the pool is empty, smaller allocations and
+// allocations made while huge pages are disabled use
+// normal pages, the memory is aligned to at least the given
+// alignment, throws std::bad_alloc on failure
+void* huge_alloc(const size_t& n_bytes, const size_t& alignment);
+void huge_free(void* ptr, const size_t& n_bytes, const size_t& alignment);
+// enable or disable huge pages for all later
+// allocations, enabled by default
+bool huge_pages(void);
+void huge_pages(const bool& enabled);
+
+// allocator of the containers holding the large arrays of
+// the scene, i.e. the nodes of the tree and the packets
+template<typename T>
+class HugePageAllocator {
+public:
+    typedef T value_type;
+    // constructors
+    HugePageAllocator(void) = default;
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) {}
+    // allocate and release the memory of n elements
+    T* allocate(const size_t& n) { return static_cast<T*>(huge_alloc(n * sizeof(T), alignof(T))); }
+    void deallocate(T* ptr, const size_t& n) { huge_free(ptr, n * sizeof(T), alignof(T)); }
+};
+
+// the allocator is stateless and all
+// instances share their memory
+template<typename T, typename U>
+bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return true; }
+template<typename T, typename U>
+bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return false; }
+
+// vector whose memory is backed by huge pages once it is large
+template<typename T>
+using HugeVector = std::vector<T, HugePageAllocator<T>>;
+
+#endif // H_HUGEPAGES
@@ -1,6 +1,7 @@
 #include <chrono>
 #include <iostream>
 #include "./vec.hpp"
+#include "./arena.hpp"
 #include "./camera.hpp"
 #include "./scene.hpp"
 #include "./primitive.hpp"
@@ -22,13 +23,16 @@ int main(void) {
     cam.fov(40.0f);
     cam.vp_dist(1.35f * 20 + 1e-3f);
 
+    // all objects of the scene are created in an arena
+    // which is handed over to the scene later on
+    Arena arena;
     // create all materials
-    mtl::Material* light = new mtl::Light(new txr::Constant(Vec3f::ones * 3.0f));
-    mtl::Material* red = new mtl::Lambertian(new txr::Constant(Vec3f(0.25f, 0.25f, 0.75f)));
-    mtl::Material* blue = new mtl::Lambertian(new txr::Constant(Vec3f(0.75f, 0.25f, 0.25f)));
-    mtl::Material* white = new mtl::Lambertian(new txr::Constant(Vec3f(0.75f, 0.75f, 0.75f)));
-    mtl::Material* glass = new mtl::Dielectric(new txr::Constant(Vec3f(1.0f, 1.0f, 1.0f)), 1.5f);
-    mtl::Material* mirror = new mtl::Metallic(new txr::Constant(Vec3f(1.0f, 1.0f, 1.0f)), 0.0f);
+    mtl::Material* light = arena.create<mtl::Light>(arena.create<txr::Constant>(Vec3f::ones * 3.0f));
+    mtl::Material* red = arena.create<mtl::Lambertian>(arena.create<txr::Constant>(Vec3f(0.25f, 0.25f, 0.75f)));
+    mtl::Material* blue = arena.create<mtl::Lambertian>(arena.create<txr::Constant>(Vec3f(0.75f, 0.25f, 0.25f)));
+    mtl::Material* white = arena.create<mtl::Lambertian>(arena.create<txr::Constant>(Vec3f(0.75f, 0.75f, 0.75f)));
+    mtl::Material* glass = arena.create<mtl::Dielectric>(arena.create<txr::Constant>(Vec3f(1.0f, 1.0f, 1.0f)), 1.5f);
+    mtl::Material* mirror = arena.create<mtl::Metallic>(arena.create<txr::Constant>(Vec3f(1.0f, 1.0f, 1.0f)), 0.0f);
 
     // create cornell box mesh
     Mesh cornell = Mesh::CornellBox(white, red, blue, light);
@@ -65,17 +69,18 @@ int main(void) {
     // check the number of triangles
     cout << "#Triangles: " << cornell.size() << endl;
     
-    // convert mesh to boundable list to easily add
-    // primitives other than triangles (e.g. spheres)
+    // primitives other than the triangles of the
+    // mesh (e.g. spheres) are passed as boundables
     BoundableList objects;
-    objects.insert(objects.begin(), cornell.begin(), cornell.end());
     // insert sphere
-    objects.push_back(new Sphere(Vec3f(0.7, 0.45, -0.3) * 20, 0.15 * 20, glass));
-    objects.push_back(new Sphere(Vec3f(0.3, 0.15, -0.3) * 20, 0.15 * 20, mirror));
+    objects.push_back(arena.create<Sphere>(Vec3f(0.7, 0.45, -0.3) * 20, 0.15 * 20, glass));
+    objects.push_back(arena.create<Sphere>(Vec3f(0.3, 0.15, -0.3) * 20, 0.15 * 20, mirror));
 
     // build scene and renderer
-    Scene scene(objects);
+    Scene scene(cornell, objects, std::move(arena));
     Renderer renderer(scene, cam, 32, 10);
+    renderer.regeneration(true);
+    renderer.reordering(true);
     FrameBuffer fb(200, 200);
 
     cout << "Rendering... " << flush;
@@ -85,6 +90,16 @@ int main(void) {
     auto stop = chrono::steady_clock::now();
     cout << chrono::duration_cast<chrono::milliseconds>(stop - start).count() / 1000.0f << "s" 
          << endl;
+    // print some statistics of the render call
+    RenderStats stats = renderer.stats();
+    cout << "#Rays: " << stats.n_rays << endl;
+    if (stats.n_leaf_visits > 0) {
+        cout << "Leaf cache hit rate: " << 100.0f * stats.n_leaf_hits / stats.n_leaf_visits << "%" << endl;
+    }
+    if (stats.tile_cache.n_hits + stats.tile_cache.n_misses > 0) {
+        cout << "Texture cache: " << stats.tile_cache.n_hits << " hits, " << stats.tile_cache.n_misses << " misses, "
+             << stats.tile_cache.n_bytes_read / (1024.0f * 1024.0f) << "MB read" << endl;
+    }
     // save the rendered image to disk 
     fb.save_to_bmp("/mnt/c/users/Nicla/OneDrive/Bilder/cornell.bmp");
 }
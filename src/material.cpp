@@ -1,18 +1,19 @@
 #include "./material.hpp"
 #include "./primitive.hpp"
 #include "./ray.hpp"
-#include <rng.hpp>
 #include <math.h>
+#include <vector>
+#include <algorithm>
 
 // use material namespace
 using namespace mtl;
 
-// helper function returning a random 
-// unit vector sampled unitformly from 
-// the surface of a unit hemisphere
-Vec3f rand_unit_vec(void) {
-    float z = rng::randf() * 2.0f - 1.0f;
-    float a = rng::randf() * 2.0f * M_PI;
+// helper function mapping two uniform
+// numbers to a unit vector distributed
+// uniformly on the unit sphere
+Vec3f unit_vec(const float& u1, const float& u2) {
+    float z = u1 * 2.0f - 1.0f;
+    float a = u2 * 2.0f * M_PI;
     float r = sqrtf(1.0f - z * z);
     return Vec3f(r * cosf(a), r * sinf(a), z);
 }
@@ -45,6 +46,7 @@ Material::Material(
 
 bool Material::scatter(
     const HitRecord& h,
+    const Vec3f& u,
     Ray& scatter
 ) const {
     // check if the incident ray
@@ -62,12 +64,12 @@ bool Material::scatter(
     refl_p = (refl_p > refl)? refl_p : refl;
     // test if the scatter ray
     // should come from reflection
-    if (rng::randf() < refl_p) {
+    if (u[0] < refl_p) {
         // scatter by reflection
         scatter.direction = h.v - ((dt + dt) * h.n);
         // add randomness
         if (is_fuzzy) {
-            scatter.direction = scatter.direction + fuzz * rand_unit_vec();
+            scatter.direction = scatter.direction + fuzz * unit_vec(u[1], u[2]);
             scatter.direction = scatter.direction.normalize();
         }
     } else if (transparent) {
@@ -89,12 +91,12 @@ bool Material::scatter(
         }
         // add some randomness to the direction
         if (is_fuzzy) {
-            scatter.direction = scatter.direction + fuzz * rand_unit_vec();
+            scatter.direction = scatter.direction + fuzz * unit_vec(u[1], u[2]);
             scatter.direction = scatter.direction.normalize();
         }
     } else {
         // scatter by hemisphere sampling
-        scatter.direction = h.n + rand_unit_vec();
+        scatter.direction = h.n + unit_vec(u[1], u[2]);
         scatter.direction = scatter.direction.normalize();
     }
     // origin is always the
@@ -108,14 +110,63 @@ Vec3f Material::attenuation(const HitRecord& h) const {
     // return the attenuation color value 
     // of the texture at the hitpoint
     // and zeros if the texture is not set
-    return (att)? att->color(h.p) : Vec3f::zeros;
+    return (att)? att->sample(h.p, h.uv, h.footprint * h.uv_density) : Vec3f::zeros;
 }
 
 Vec3f Material::emittance(const HitRecord& h) const {
     // return the emittance color value 
     // of the texture at the hitpoint
     // and zeros if the texture is not set
-    return (emit)? emit->color(h.p) : Vec3f::zeros;
+    return (emit)? emit->sample(h.p, h.uv, h.footprint * h.uv_density) : Vec3f::zeros;
+}
+
+// the points, texture coordinates and footprints of
+// a batch of hits laid out as the textures expect them
+typedef struct TextureBatch {
+    std::vector<float> px, py, pz;
+    std::vector<txr::TexCoord> uvs;
+    std::vector<float> widths;
+} TextureBatch;
+
+static const TextureBatch& gather(
+    const HitRecord* hits,
+    const size_t& n
+) {
+    // reuse the memory of the calling thread
+    static thread_local TextureBatch batch;
+    batch.px.resize(n);
+    batch.py.resize(n);
+    batch.pz.resize(n);
+    batch.uvs.resize(n);
+    batch.widths.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        batch.px[i] = hits[i].p[0];
+        batch.py[i] = hits[i].p[1];
+        batch.pz[i] = hits[i].p[2];
+        batch.uvs[i] = hits[i].uv;
+        batch.widths[i] = hits[i].footprint * hits[i].uv_density;
+    }
+    return batch;
+}
+
+void Material::attenuation(
+    const HitRecord* hits,
+    const size_t& n,
+    Vec3f* out
+) const {
+    if (att == nullptr) { std::fill(out, out + n, Vec3f::zeros); return; }
+    const TextureBatch& b = gather(hits, n);
+    att->sample(b.px.data(), b.py.data(), b.pz.data(), b.uvs.data(), b.widths.data(), n, out);
+}
+
+void Material::emittance(
+    const HitRecord* hits,
+    const size_t& n,
+    Vec3f* out
+) const {
+    if (emit == nullptr) { std::fill(out, out + n, Vec3f::zeros); return; }
+    const TextureBatch& b = gather(hits, n);
+    emit->sample(b.px.data(), b.py.data(), b.pz.data(), b.uvs.data(), b.widths.data(), n, out);
 }
 
 /*
@@ -197,6 +248,7 @@ Light::Light(
 
 bool Light::scatter(
     const HitRecord& h,
+    const Vec3f& u,
     Ray& scatter
 ) const {
     // light materials do not
@@ -224,13 +276,21 @@ Debug::Debug(void) :
 {
 }
 
-bool Debug::scatter(const HitRecord& h, Ray& scatter) const 
+bool Debug::scatter(const HitRecord& h, const Vec3f& u, Ray& scatter) const 
 {
     // debugging materials do not
     // generate secondary rays
     return false; 
 }
 
+void Debug::emittance(
+    const HitRecord* hits,
+    const size_t& n,
+    Vec3f* out
+) const {
+    for (size_t i = 0; i < n; i++) { out[i] = emittance(hits[i]); }
+}
+
 // normal materials visualizing the surface normal
 // at the intersection point as color
 Vec3f Normal::emittance(const HitRecord& h) const 
@@ -33,6 +33,8 @@ public:
     // false when there is no scatter ray
     virtual bool scatter(
         const HitRecord& h, // the hitrecord of the in ray
+        const Vec3f& u,     // uniform numbers in [0, 1) picking the
+                            // lobe (first) and the direction (others)
         Ray& scatter        // output scatter ray
     ) const;
     // method that returns the 
@@ -41,6 +43,18 @@ public:
     // method that returns the
     // emittance color
     virtual Vec3f emittance(const HitRecord& h) const;
+    // batched versions of the above evaluating the
+    // textures of n hits of this material at once
+    virtual void attenuation(
+        const HitRecord* hits,
+        const size_t& n,
+        Vec3f* out
+    ) const;
+    virtual void emittance(
+        const HitRecord* hits,
+        const size_t& n,
+        Vec3f* out
+    ) const;
 };
 
 // lambertian material has
@@ -86,6 +100,7 @@ public:
     // always return false
     virtual bool scatter(
         const HitRecord& h,
+        const Vec3f& u,
         Ray& scatter
     ) const;
 };
@@ -104,11 +119,19 @@ public:
     // never generate secondary rays
     virtual bool scatter(
         const HitRecord& h,
+        const Vec3f& u,
         Ray& scatter
     ) const;
     // debug materials only need to
     // define an emittance function 
     virtual Vec3f emittance(const HitRecord& h) const = 0;
+    // the batched version evaluates the
+    // emittance function hit by hit
+    virtual void emittance(
+        const HitRecord* hits,
+        const size_t& n,
+        Vec3f* out
+    ) const;
 };
 
 // normal material visualizing the
@@ -1,73 +1,676 @@
 #include "./mesh.hpp"
-#include "./primitive.hpp"
-#include <fstream>
-
-Mesh::Mesh(
-    const Mesh::const_iterator& begin,
-    const Mesh::const_iterator& end
-) :
-    std::vector<Triangle*>(begin, end)
-{
-}
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /*
  *  Obj File Loader
  */
 
+// vertices and triangles parsed from a
+// line-aligned chunk of an obj file
+typedef struct ObjChunk {
+    std::vector<Vec3f> vertices;
+    std::vector<txr::TexCoord> texcoords;
+    // corner indices of the triangles, non-negative values
+    // are absolute while negative values are relative to the
+    // first vertex of the chunk and shifted by obj_relative
+    std::vector<int64_t> indices;
+    // texture coordinate indices of the corners
+    // encoded the same way as the vertex indices
+    std::vector<int64_t> uv_indices;
+} ObjChunk;
+
+// shift of indices relative to the first vertex
+// of a chunk, makes all of them negative
+const int64_t obj_relative = (int64_t)1 << 62;
+// marks corners without texture coordinates
+const int64_t obj_missing = INT64_MIN;
+
+// texture coordinates of the corners of a triangle
+// without texture coordinates, i.e. the barycentric
+// coordinates of its corners
+const txr::TexCoord corner_uv[3] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f } };
+
+inline bool is_space(const char& c) { return (c == ' ') || (c == '\t') || (c == '\r'); }
+inline bool is_digit(const char& c) { return (c >= '0') && (c <= '9'); }
+
+inline const char* skip_space(const char* p, const char* end) {
+    while ((p < end) && is_space(*p)) { p++; }
+    return p;
+}
+
+// parse a signed integer and return the position
+// after it, stays in place if there is no number
+inline const char* parse_int(const char* p, const char* end, int64_t& value) {
+    const char* q = p;
+    bool neg = (q < end) && (*q == '-');
+    if ((q < end) && ((*q == '-') || (*q == '+'))) { q++; }
+    if ((q == end) || !is_digit(*q)) { return p; }
+    int64_t v = 0;
+    while ((q < end) && is_digit(*q)) { v = 10 * v + (*q++ - '0'); }
+    value = neg? -v : v;
+    return q;
+}
+
+// parse a floating point number of the form
+// [+-]digits[.digits][(e|E)[+-]digits]
+inline const char* parse_float(const char* p, const char* end, float& value) {
+    // exact powers of ten representable as double
+    static const double pow10[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* q = p;
+    bool neg = (q < end) && (*q == '-');
+    if ((q < end) && ((*q == '-') || (*q == '+'))) { q++; }
+    // collect the significant digits into an integer
+    // and track the decimal exponent separately
+    uint64_t m = 0;
+    int e = 0, n_digits = 0;
+    bool any = false;
+    while ((q < end) && is_digit(*q)) {
+        if (n_digits < 19) { m = 10 * m + (*q - '0'); n_digits += (m > 0); } else { e++; }
+        q++; any = true;
+    }
+    if ((q < end) && (*q == '.')) {
+        q++;
+        while ((q < end) && is_digit(*q)) {
+            if (n_digits < 19) { m = 10 * m + (*q - '0'); n_digits += (m > 0); e--; }
+            q++; any = true;
+        }
+    }
+    if (!any) { return p; }
+    // exponent
+    if ((q < end) && ((*q == 'e') || (*q == 'E'))) {
+        int64_t x = 0;
+        const char* r = parse_int(q + 1, end, x);
+        if (r != q + 1) { e += x; q = r; }
+    }
+    // scale the digits by the power of ten
+    double v = (double)m;
+    if ((e >= -22) && (e <= 22)) { v = (e < 0)? v / pow10[-e] : v * pow10[e]; }
+    else { v *= pow(10.0, e); }
+    value = (float)(neg? -v : v);
+    return q;
+}
+
+// parse all complete lines in the given range
+static void parse_obj_chunk(const char* p, const char* end, ObjChunk& chunk)
+{
+    // vertex and texture coordinate
+    // indices of the current face
+    std::vector<int64_t> face, face_uv;
+    while (p < end) {
+        p = skip_space(p, end);
+        // the keyword needs to be followed by a space
+        // to tell vertices apart from normals etc.
+        bool has_arg = (p + 1 < end) && is_space(p[1]);
+        if (has_arg && (*p == 'v')) {
+            // vertex position
+            float xyz[3] = { 0.0f, 0.0f, 0.0f };
+            p += 2;
+            for (size_t k = 0; k < 3; k++) {
+                p = parse_float(skip_space(p, end), end, xyz[k]);
+            }
+            chunk.vertices.push_back(Vec3f(xyz[0], xyz[1], xyz[2]));
+        } else if ((p + 2 < end) && (p[0] == 'v') && (p[1] == 't') && is_space(p[2])) {
+            // texture coordinates
+            txr::TexCoord uv = { 0.0f, 0.0f };
+            p = parse_float(skip_space(p + 3, end), end, uv.u);
+            p = parse_float(skip_space(p, end), end, uv.v);
+            chunk.texcoords.push_back(uv);
+        } else if (has_arg && (*p == 'f')) {
+            // face given by its corners of the form
+            // v, v/vt, v//vn or v/vt/vn
+            face.clear();
+            face_uv.clear();
+            p += 2;
+            while (true) {
+                int64_t i = 0, j = 0, tmp;
+                const char* start = skip_space(p, end);
+                const char* q = parse_int(start, end, i);
+                if ((q == start) || (i == 0)) { break; }
+                // the texture index is optional
+                // and the normal index is skipped
+                bool has_uv = false;
+                if ((q < end) && (*q == '/')) {
+                    const char* r = parse_int(q + 1, end, j);
+                    has_uv = (r != q + 1) && (j != 0);
+                    q = r;
+                }
+                while ((q < end) && (*q == '/')) { q = parse_int(q + 1, end, tmp); }
+                p = q;
+                // one-based absolute index or
+                // negative index relative to the
+                // most recent vertex
+                face.push_back((i > 0)? i - 1 : (int64_t)chunk.vertices.size() + i - obj_relative);
+                face_uv.push_back(!has_uv? obj_missing :
+                    (j > 0)? j - 1 : (int64_t)chunk.texcoords.size() + j - obj_relative);
+            }
+            // triangulate the face as a fan
+            for (size_t k = 2; k < face.size(); k++) {
+                chunk.indices.push_back(face[0]);
+                chunk.indices.push_back(face[k - 1]);
+                chunk.indices.push_back(face[k]);
+                chunk.uv_indices.push_back(face_uv[0]);
+                chunk.uv_indices.push_back(face_uv[k - 1]);
+                chunk.uv_indices.push_back(face_uv[k]);
+            }
+        }
+        // skip to next line
+        while ((p < end) && (*p != '\n')) { p++; }
+        p++;
+    }
+}
+
 Mesh Mesh::load_obj(
     const char* fpath,
     const mtl::Material* mat
 ) {
     Mesh mesh;
-    // open filestream
-    std::ifstream f(fpath);
-    // create vertex list        
-    std::vector<Vec3f> vs;
-
-    // vertex parser
-    auto parse_vertex = [&vs, &f](void) {
-        float x, y, z;
-        f >> x >> y >> z;
-        vs.push_back(Vec3f(x, y, z));
-    };
-    // face parser
-    auto parse_face = [&mesh, &vs, &f, &mat](void) {
-        // read first two index
-        size_t i, j, k; 
-        f >> i >> j;
-        do {
-            // read next index
-            f >> k;
-            // build face and add it
-            // to the mesh
-            mesh.push_back(new Triangle(
-                vs[i-1], vs[j-1], vs[k-1], mat
-            ));
-            // update index
-            j = k;
-        } while (f.peek() != '\n');
-    };
+    // map the whole file into memory
+    int fd = open(fpath, O_RDONLY);
+    if (fd < 0) { return mesh; }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size == 0)) { close(fd); return mesh; }
+    size_t size = st.st_size;
+    const char* data = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) { return mesh; }
+    madvise((void*)data, size, MADV_SEQUENTIAL);
+    
+    // split the file into one chunk per thread
+    // where each chunk starts at a new line
+    size_t n_threads = std::thread::hardware_concurrency();
+    n_threads = std::max<size_t>(1, std::min<size_t>(n_threads, size >> 16));
+    std::vector<const char*> bounds(n_threads + 1, data + size);
+    bounds[0] = data;
+    for (size_t i = 1; i < n_threads; i++) {
+        const char* p = std::max(data + size * i / n_threads, bounds[i - 1]);
+        while ((p < data + size) && (*p != '\n')) { p++; }
+        bounds[i] = std::min(p + 1, data + size);
+    }
+    // parse all chunks in parallel
+    std::vector<ObjChunk> chunks(n_threads);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < n_threads; i++) {
+        workers.emplace_back(parse_obj_chunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+    }
+    for (std::thread& w : workers) { w.join(); }
+    workers.clear();
+    munmap((void*)data, size);
+
+    // offsets of the chunks in the merged arrays
+    std::vector<size_t> v_offsets(n_threads + 1, 0);
+    std::vector<size_t> t_offsets(n_threads + 1, 0);
+    std::vector<size_t> i_offsets(n_threads + 1, 0);
+    for (size_t i = 0; i < n_threads; i++) {
+        v_offsets[i + 1] = v_offsets[i] + chunks[i].vertices.size();
+        t_offsets[i + 1] = t_offsets[i] + chunks[i].texcoords.size();
+        i_offsets[i + 1] = i_offsets[i] + chunks[i].indices.size();
+    }
+    size_t n_vertices = v_offsets[n_threads];
+    mesh._vertices.resize(n_vertices);
+    mesh._indices.resize(i_offsets[n_threads]);
+    // the texture coordinates are resolved per corner, thus
+    // all of them need to be merged before the indices
+    size_t n_texcoords = t_offsets[n_threads];
+    std::vector<txr::TexCoord> texcoords;
+    texcoords.reserve(n_texcoords);
+    for (const ObjChunk& chunk : chunks) {
+        texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+    }
+    if (n_texcoords > 0) { mesh._texcoords.resize(i_offsets[n_threads]); }
+    // merge the chunks in parallel, relative indices
+    // are resolved by the offset of their chunk and
+    // invalid indices are marked to be removed
+    std::vector<size_t> n_invalid(n_threads, 0);
+    for (size_t i = 0; i < n_threads; i++) {
+        workers.emplace_back([&, i](void) {
+            const ObjChunk& chunk = chunks[i];
+            std::copy(chunk.vertices.begin(), chunk.vertices.end(), mesh._vertices.begin() + v_offsets[i]);
+            uint32_t* out = mesh._indices.data() + i_offsets[i];
+            for (size_t k = 0; k < chunk.indices.size(); k++) {
+                int64_t j = chunk.indices[k];
+                if (j < 0) { j += obj_relative + v_offsets[i]; }
+                bool valid = (j >= 0) && ((size_t)j < n_vertices);
+                out[k] = valid? (uint32_t)j : (uint32_t)-1;
+                n_invalid[i] += !valid;
+            }
+            // corners without valid texture coordinates
+            // use the barycentric ones of the corner
+            if (n_texcoords == 0) { return; }
+            txr::TexCoord* uv_out = mesh._texcoords.data() + i_offsets[i];
+            for (size_t k = 0; k < chunk.uv_indices.size(); k++) {
+                int64_t j = chunk.uv_indices[k];
+                if ((j < 0) && (j != obj_missing)) { j += obj_relative + t_offsets[i]; }
+                bool valid = (j >= 0) && ((size_t)j < n_texcoords);
+                uv_out[k] = valid? texcoords[j] : corner_uv[k % 3];
+            }
+        });
+    }
+    for (std::thread& w : workers) { w.join(); }
+    // drop the triangles referring to vertices
+    // that do not exist in the file
+    if (std::accumulate(n_invalid.begin(), n_invalid.end(), (size_t)0) > 0) {
+        mesh.drop_invalid_triangles();
+    }
+    // all triangles share the same material
+    mesh._mtl_ids.assign(mesh._indices.size() / 3, mesh.material_id(mat));
+    // return the mesh
+    return mesh;
+}
+
+/*
+ *  Ply File Loader
+ */
+
+// scalar types of ply properties
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+inline PlyType ply_type(const std::string& name) {
+    if ((name == "char") || (name == "int8")) { return PlyType::Int8; }
+    if ((name == "uchar") || (name == "uint8")) { return PlyType::UInt8; }
+    if ((name == "short") || (name == "int16")) { return PlyType::Int16; }
+    if ((name == "ushort") || (name == "uint16")) { return PlyType::UInt16; }
+    if ((name == "int") || (name == "int32")) { return PlyType::Int32; }
+    if ((name == "uint") || (name == "uint32")) { return PlyType::UInt32; }
+    if ((name == "float") || (name == "float32")) { return PlyType::Float32; }
+    if ((name == "double") || (name == "float64")) { return PlyType::Float64; }
+    return PlyType::Invalid;
+}
+
+inline size_t ply_size(const PlyType& type) {
+    switch (type) {
+        case PlyType::Int8: case PlyType::UInt8: return 1;
+        case PlyType::Int16: case PlyType::UInt16: return 2;
+        case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+        case PlyType::Float64: return 8;
+        default: return 0;
+    }
+}
+
+// decode a value of the given type, the bytes
+// are reversed if the file has foreign byte order
+inline double ply_value(const char* p, const PlyType& type, const bool& swap) {
+    char b[8];
+    size_t n = ply_size(type);
+    for (size_t k = 0; k < n; k++) { b[k] = swap? p[n - 1 - k] : p[k]; }
+    switch (type) {
+        case PlyType::Int8: return *(int8_t*)b;
+        case PlyType::UInt8: return *(uint8_t*)b;
+        case PlyType::Int16: { int16_t v; memcpy(&v, b, 2); return v; }
+        case PlyType::UInt16: { uint16_t v; memcpy(&v, b, 2); return v; }
+        case PlyType::Int32: { int32_t v; memcpy(&v, b, 4); return v; }
+        case PlyType::UInt32: { uint32_t v; memcpy(&v, b, 4); return v; }
+        case PlyType::Float32: { float v; memcpy(&v, b, 4); return v; }
+        case PlyType::Float64: { double v; memcpy(&v, b, 8); return v; }
+        default: return 0.0;
+    }
+}
+
+// property of an element, list properties
+// store their length in front of the items
+typedef struct PlyProperty {
+    std::string name;
+    PlyType type;
+    bool is_list;
+    PlyType count_type;
+} PlyProperty;
 
-    // read file and build mesh
-    char ch;
-    while (f >> ch) {
-        switch (ch) {
-            case 'v':
-                parse_vertex();
-                break;
-            case 'f':
-                parse_face();
-                break;
-            default:
-                break;
+typedef struct PlyElement {
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> props;
+} PlyElement;
+
+// reads a file through a buffer of fixed size and
+// hands out pointers to contiguous ranges of bytes
+class PlyStream {
+private:
+    FILE* f;
+    std::vector<char> buffer;
+    size_t pos = 0, end = 0;
+public:
+    PlyStream(FILE* f, const size_t& size) : f(f), buffer(size) {}
+    // get the next n bytes, nullptr if the file ends early
+    const char* next(const size_t& n) {
+        if (end - pos < n) {
+            // move the remaining bytes to the front
+            // and fill up the rest of the buffer
+            std::copy(buffer.begin() + pos, buffer.begin() + end, buffer.begin());
+            end -= pos; pos = 0;
+            if (n > buffer.size()) { buffer.resize(n); }
+            end += fread(buffer.data() + end, 1, buffer.size() - end, f);
+            if (end < n) { return nullptr; }
         }
-        // skip to next line
-        f.ignore(256, '\n');
+        const char* p = buffer.data() + pos;
+        pos += n;
+        return p;
+    }
+    // read a line of the header
+    bool line(std::string& s) {
+        s.clear();
+        const char* c;
+        while ((c = next(1)) != nullptr) {
+            if (*c == '\n') { return true; }
+            if (*c != '\r') { s.push_back(*c); }
+        }
+        return !s.empty();
     }
+};
+
+Mesh Mesh::load_ply(
+    const char* fpath,
+    const mtl::Material* mat
+) {
+    Mesh mesh;
+    FILE* f = fopen(fpath, "rb");
+    if (f == nullptr) { return mesh; }
+    // the size of the file bounds all counts, larger
+    // counts can only come from a corrupt file
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0) { fclose(f); return mesh; }
+    const double file_size = st.st_size;
+    // the file is read in chunks of 1MB
+    PlyStream stream(f, 1 << 20);
+    
+    // parse the header
+    std::string line, word;
+    std::vector<PlyElement> elements;
+    bool valid = stream.line(line) && (line == "ply");
+    bool binary = false, swap = false;
+    while (valid && stream.line(line) && (line != "end_header")) {
+        std::istringstream ls(line);
+        ls >> word;
+        if (word == "format") {
+            // the data is binary in either byte order,
+            // swap if it differs from the own one
+            ls >> word;
+            const uint16_t probe = 1;
+            bool little = *(const uint8_t*)&probe == 1;
+            binary = (word == "binary_little_endian") || (word == "binary_big_endian");
+            swap = (word == "binary_little_endian")? !little : little;
+        } else if (word == "element") {
+            PlyElement e;
+            ls >> e.name >> e.count;
+            elements.push_back(e);
+        } else if ((word == "property") && !elements.empty()) {
+            PlyProperty p;
+            ls >> word;
+            p.is_list = (word == "list");
+            if (p.is_list) {
+                ls >> word; p.count_type = ply_type(word);
+                ls >> word;
+            }
+            p.type = ply_type(word);
+            ls >> p.name;
+            valid &= (p.type != PlyType::Invalid) && (!p.is_list || (p.count_type != PlyType::Invalid));
+            elements.back().props.push_back(p);
+        }
+    }
+    valid &= binary;
+
+    // read the body element by element
+    for (size_t e = 0; valid && (e < elements.size()); e++) {
+        const PlyElement& elem = elements[e];
+        if (elem.name == "vertex") {
+            // offsets of the coordinates in a record, only
+            // possible if all properties have a fixed size
+            size_t record = 0;
+            int64_t offsets[3] = { -1, -1, -1 };
+            PlyType types[3];
+            for (const PlyProperty& p : elem.props) {
+                valid &= !p.is_list;
+                for (size_t k = 0; k < 3; k++) {
+                    if (p.name == std::string(1, 'x' + k)) { offsets[k] = record; types[k] = p.type; }
+                }
+                record += ply_size(p.type);
+            }
+            valid &= (offsets[0] >= 0) && (offsets[1] >= 0) && (offsets[2] >= 0)
+                && ((double)elem.count * record <= file_size);
+            if (!valid) { break; }
+            mesh._vertices.reserve(elem.count);
+            for (size_t i = 0; valid && (i < elem.count); i++) {
+                const char* r = stream.next(record);
+                if (r == nullptr) { valid = false; break; }
+                mesh._vertices.push_back(Vec3f(
+                    ply_value(r + offsets[0], types[0], swap),
+                    ply_value(r + offsets[1], types[1], swap),
+                    ply_value(r + offsets[2], types[2], swap)
+                ));
+            }
+        } else {
+            // faces use the list of vertex indices while
+            // all other elements and properties are skipped
+            bool is_face = (elem.name == "face");
+            valid &= ((double)elem.count <= file_size);
+            if (!valid) { break; }
+            if (is_face) { mesh._indices.reserve(3 * elem.count); }
+            std::vector<uint32_t> face;
+            for (size_t i = 0; valid && (i < elem.count); i++) {
+                for (const PlyProperty& p : elem.props) {
+                    size_t n = 1;
+                    if (p.is_list) {
+                        const char* c = stream.next(ply_size(p.count_type));
+                        if (c == nullptr) { valid = false; break; }
+                        // a list cannot be longer than the file
+                        double count = ply_value(c, p.count_type, swap);
+                        if (!(count >= 0.0) || (count * ply_size(p.type) > file_size)) { valid = false; break; }
+                        n = count;
+                    }
+                    const char* items = stream.next(n * ply_size(p.type));
+                    if (items == nullptr) { valid = false; break; }
+                    if (!is_face || !p.is_list || ((p.name != "vertex_indices") && (p.name != "vertex_index"))) { continue; }
+                    // faces with an index that is not a whole
+                    // number in the range of uint32_t are skipped
+                    face.clear();
+                    for (size_t k = 0; k < n; k++) {
+                        double v = ply_value(items + k * ply_size(p.type), p.type, swap);
+                        if (!((v >= 0.0) && (v < 4294967296.0)) || (v != (uint32_t)v)) { break; }
+                        face.push_back((uint32_t)v);
+                    }
+                    if (face.size() != n) { continue; }
+                    // triangulate the face as a fan
+                    for (size_t k = 2; k < n; k++) {
+                        mesh._indices.push_back(face[0]);
+                        mesh._indices.push_back(face[k - 1]);
+                        mesh._indices.push_back(face[k]);
+                    }
+                }
+            }
+        }
+    }
+    fclose(f);
+    if (!valid) { return Mesh(); }
+    // drop the triangles referring to vertices
+    // that do not exist in the file
+    mesh.drop_invalid_triangles();
+    // all triangles share the same material
+    mesh._mtl_ids.assign(mesh._indices.size() / 3, mesh.material_id(mat));
     // return the mesh
     return mesh;
 }
 
+/*
+ *  Binary Mesh Cache
+ */
+
+// header at the beginning of a mesh cache file, the
+// arrays follow at 64-byte aligned offsets and are
+// stored in the byte order of the writing machine
+typedef struct MeshCacheHeader {
+    char magic[8];              // "FAIRMESH"
+    uint32_t version;           // format version
+    uint32_t n_materials;       // number of material ids in use
+    uint64_t n_vertices;
+    uint64_t n_triangles;
+    uint64_t vertex_offset;     // Vec3f per vertex
+    uint64_t index_offset;      // three uint32 per triangle
+    uint64_t mtl_offset;        // uint32 per triangle
+    uint64_t n_texcoords;       // zero or three per triangle
+    uint64_t texcoord_offset;   // TexCoord per corner
+    uint64_t source_size;       // size of the source file
+    uint64_t source_mtime;      // modification time of the source file in ns
+    uint64_t size;              // size of the whole file
+} MeshCacheHeader;
+
+const char mesh_cache_magic[8] = { 'F', 'A', 'I', 'R', 'M', 'E', 'S', 'H' };
+const uint32_t mesh_cache_version = 3;
+
+// round up to the alignment of the arrays
+inline uint64_t cache_align(const uint64_t& n) { return (n + 63) & ~(uint64_t)63; }
+
+// helper function getting the size and the modification
+// time of the file the cache was built from, both are
+// zero if no source file is given
+static bool source_stamp(
+    const char* fpath,
+    uint64_t& size,
+    uint64_t& mtime
+) {
+    size = mtime = 0;
+    if (fpath == nullptr) { return true; }
+    struct stat st;
+    if (stat(fpath, &st) != 0) { return false; }
+    size = st.st_size;
+    mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+    return true;
+}
+
+bool Mesh::save_cache(
+    const char* fpath,
+    const char* source_fpath
+) const {
+    // build the header
+    MeshCacheHeader header;
+    std::copy(mesh_cache_magic, mesh_cache_magic + 8, header.magic);
+    header.version = mesh_cache_version;
+    if (!source_stamp(source_fpath, header.source_size, header.source_mtime)) { return false; }
+    header.n_materials = _materials.size();
+    header.n_vertices = _vertices.size();
+    header.n_triangles = size();
+    header.vertex_offset = cache_align(sizeof(MeshCacheHeader));
+    header.index_offset = cache_align(header.vertex_offset + header.n_vertices * sizeof(Vec3f));
+    header.mtl_offset = cache_align(header.index_offset + header.n_triangles * 3 * sizeof(uint32_t));
+    header.n_texcoords = _texcoords.size();
+    header.texcoord_offset = cache_align(header.mtl_offset + header.n_triangles * sizeof(uint32_t));
+    header.size = header.texcoord_offset + header.n_texcoords * sizeof(txr::TexCoord);
+    // write the header and the arrays at their offsets
+    FILE* f = fopen(fpath, "wb");
+    if (f == nullptr) { return false; }
+    auto write_at = [f](const uint64_t& offset, const void* data, const size_t& n) {
+        return (fseek(f, offset, SEEK_SET) == 0) && (fwrite(data, 1, n, f) == n);
+    };
+    bool ok = write_at(0, &header, sizeof(MeshCacheHeader))
+        && write_at(header.vertex_offset, _vertices.data(), header.n_vertices * sizeof(Vec3f))
+        && write_at(header.index_offset, _indices.data(), _indices.size() * sizeof(uint32_t))
+        && write_at(header.mtl_offset, _mtl_ids.data(), _mtl_ids.size() * sizeof(uint32_t))
+        && ((header.n_texcoords == 0) || write_at(header.texcoord_offset, _texcoords.data(), header.n_texcoords * sizeof(txr::TexCoord)));
+    // without texture coordinates the file ends before
+    // the aligned offset of their array, pad it such
+    // that it has the size given in the header
+    ok = ok && (fflush(f) == 0) && (ftruncate(fileno(f), header.size) == 0);
+    return (fclose(f) == 0) && ok;
+}
+
+Mesh Mesh::load_cache(
+    const char* fpath,
+    const std::vector<const mtl::Material*>& materials,
+    const char* source_fpath
+) {
+    Mesh mesh;
+    uint64_t source_size, source_mtime;
+    if (!source_stamp(source_fpath, source_size, source_mtime)) { return mesh; }
+    // map the whole file into memory
+    int fd = open(fpath, O_RDONLY);
+    if (fd < 0) { return mesh; }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(MeshCacheHeader))) { close(fd); return mesh; }
+    size_t size = st.st_size;
+    const char* data = (const char*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) { return mesh; }
+    // make sure the header belongs to a complete cache
+    // of the current version built from the current
+    // source file and that all material ids can be
+    // resolved, the checks of the counts come first
+    // such that the sizes below cannot overflow
+    const MeshCacheHeader& header = *(const MeshCacheHeader*)data;
+    bool valid = std::equal(mesh_cache_magic, mesh_cache_magic + 8, header.magic)
+        && (header.version == mesh_cache_version)
+        && (header.size == size)
+        && (header.source_size == source_size)
+        && (header.source_mtime == source_mtime)
+        && (header.n_materials <= materials.size())
+        && (header.n_vertices <= size / sizeof(Vec3f))
+        && (header.n_triangles <= size / (3 * sizeof(uint32_t)))
+        && ((header.n_texcoords == 0) || (header.n_texcoords == 3 * header.n_triangles));
+    // all arrays need to be aligned, follow the header
+    // and lie inside of the file without overlapping
+    auto in_file = [](const uint64_t& offset, const uint64_t& n_bytes, const uint64_t& end) {
+        return (offset % 64 == 0) && (offset >= sizeof(MeshCacheHeader))
+            && (offset <= end) && (n_bytes <= end - offset);
+    };
+    valid = valid
+        && (header.texcoord_offset <= size)
+        && (header.mtl_offset <= header.texcoord_offset)
+        && (header.index_offset <= header.mtl_offset)
+        && in_file(header.vertex_offset, header.n_vertices * sizeof(Vec3f), header.index_offset)
+        && in_file(header.index_offset, header.n_triangles * 3 * sizeof(uint32_t), header.mtl_offset)
+        && in_file(header.mtl_offset, header.n_triangles * sizeof(uint32_t), header.texcoord_offset)
+        && in_file(header.texcoord_offset, header.n_texcoords * sizeof(txr::TexCoord), size);
+    if (valid) {
+        // the arrays are stored exactly as in
+        // memory, thus they are copied in bulk
+        const Vec3f* vs = (const Vec3f*)(data + header.vertex_offset);
+        const uint32_t* is = (const uint32_t*)(data + header.index_offset);
+        const uint32_t* ms = (const uint32_t*)(data + header.mtl_offset);
+        mesh._vertices.assign(vs, vs + header.n_vertices);
+        mesh._indices.assign(is, is + 3 * header.n_triangles);
+        mesh._mtl_ids.assign(ms, ms + header.n_triangles);
+        const txr::TexCoord* ts = (const txr::TexCoord*)(data + header.texcoord_offset);
+        mesh._texcoords.assign(ts, ts + header.n_texcoords);
+        mesh._materials.assign(materials.begin(), materials.begin() + header.n_materials);
+        // reject out of range ids
+        valid = std::all_of(mesh._indices.begin(), mesh._indices.end(),
+            [&header](const uint32_t& i) { return i < header.n_vertices; })
+            && std::all_of(mesh._mtl_ids.begin(), mesh._mtl_ids.end(),
+            [&header](const uint32_t& i) { return i < header.n_materials; });
+    }
+    munmap((void*)data, size);
+    // return the mesh or an empty mesh
+    // if the cache is invalid
+    return valid? mesh : Mesh();
+}
+
+Mesh Mesh::load_obj_cached(
+    const char* obj_fpath,
+    const char* cache_fpath,
+    const mtl::Material* mat
+) {
+    // try to load the cache first, which is
+    // rejected if the obj file was changed
+    Mesh mesh = Mesh::load_cache(cache_fpath, { mat }, obj_fpath);
+    if (mesh.size() > 0) { return mesh; }
+    // fall back to the obj file
+    // and write the cache
+    mesh = Mesh::load_obj(obj_fpath, mat);
+    if (mesh.size() > 0) { mesh.save_cache(cache_fpath, obj_fpath); }
+    return mesh;
+}
+
 /*
  *  Cornell Box
  */
@@ -81,26 +684,26 @@ Mesh Mesh::CornellBox(
     // build the cornell box mesh
     Mesh cornell;
     // light
-    cornell.push_back(new Triangle(Vec3f(0.2, 0.999, -0.2), Vec3f(0.8, 0.999, -0.2), Vec3f(0.2, 0.999, -0.8), light_mtl));
-    cornell.push_back(new Triangle(Vec3f(0.8, 0.999, -0.8), Vec3f(0.2, 0.999, -0.8), Vec3f(0.8, 0.999, -0.2), light_mtl));
+    cornell.add_triangle(Vec3f(0.2, 0.999, -0.2), Vec3f(0.8, 0.999, -0.2), Vec3f(0.2, 0.999, -0.8), light_mtl);
+    cornell.add_triangle(Vec3f(0.8, 0.999, -0.8), Vec3f(0.2, 0.999, -0.8), Vec3f(0.8, 0.999, -0.2), light_mtl);
     // ceiling
-    cornell.push_back(new Triangle(Vec3f(0, 1, 0), Vec3f(0, 1, -1), Vec3f(1, 1, 0), base_mtl));
-    cornell.push_back(new Triangle(Vec3f(1, 1, -1), Vec3f(1, 1, 0), Vec3f(0, 1, -1), base_mtl));
+    cornell.add_triangle(Vec3f(0, 1, 0), Vec3f(0, 1, -1), Vec3f(1, 1, 0), base_mtl);
+    cornell.add_triangle(Vec3f(1, 1, -1), Vec3f(1, 1, 0), Vec3f(0, 1, -1), base_mtl);
     // floor
-    cornell.push_back(new Triangle(Vec3f(0, 0, 0), Vec3f(1, 0, 0), Vec3f(0, 0, -1), base_mtl));
-    cornell.push_back(new Triangle(Vec3f(1, 0, -1), Vec3f(0, 0, -1), Vec3f(1, 0, 0), base_mtl));
+    cornell.add_triangle(Vec3f(0, 0, 0), Vec3f(1, 0, 0), Vec3f(0, 0, -1), base_mtl);
+    cornell.add_triangle(Vec3f(1, 0, -1), Vec3f(0, 0, -1), Vec3f(1, 0, 0), base_mtl);
     // back
-    cornell.push_back(new Triangle(Vec3f(0, 0, -1), Vec3f(1, 0, -1), Vec3f(0, 1, -1), base_mtl));
-    cornell.push_back(new Triangle(Vec3f(1, 1, -1), Vec3f(0, 1, -1), Vec3f(1, 0, -1), base_mtl));
+    cornell.add_triangle(Vec3f(0, 0, -1), Vec3f(1, 0, -1), Vec3f(0, 1, -1), base_mtl);
+    cornell.add_triangle(Vec3f(1, 1, -1), Vec3f(0, 1, -1), Vec3f(1, 0, -1), base_mtl);
     // front
-    cornell.push_back(new Triangle(Vec3f(1, 1, 0), Vec3f(1, 0, 0), Vec3f(0, 1, 0), base_mtl));
-    cornell.push_back(new Triangle(Vec3f(0, 0, 0), Vec3f(0, 1, 0), Vec3f(1, 0, 0), base_mtl));
+    cornell.add_triangle(Vec3f(1, 1, 0), Vec3f(1, 0, 0), Vec3f(0, 1, 0), base_mtl);
+    cornell.add_triangle(Vec3f(0, 0, 0), Vec3f(0, 1, 0), Vec3f(1, 0, 0), base_mtl);
     // left
-    cornell.push_back(new Triangle(Vec3f(0, 0, 0), Vec3f(0, 0, -1), Vec3f(0, 1, 0), left_mtl));
-    cornell.push_back(new Triangle(Vec3f(0, 1, -1), Vec3f(0, 1, 0), Vec3f(0, 0, -1), left_mtl));
+    cornell.add_triangle(Vec3f(0, 0, 0), Vec3f(0, 0, -1), Vec3f(0, 1, 0), left_mtl);
+    cornell.add_triangle(Vec3f(0, 1, -1), Vec3f(0, 1, 0), Vec3f(0, 0, -1), left_mtl);
     // right
-    cornell.push_back(new Triangle(Vec3f(1, 0, 0), Vec3f(1, 1, 0), Vec3f(1, 0, -1), right_mtl));
-    cornell.push_back(new Triangle(Vec3f(1, 1, -1), Vec3f(1, 0, -1), Vec3f(1, 1, 0), right_mtl));
+    cornell.add_triangle(Vec3f(1, 0, 0), Vec3f(1, 1, 0), Vec3f(1, 0, -1), right_mtl);
+    cornell.add_triangle(Vec3f(1, 1, -1), Vec3f(1, 0, -1), Vec3f(1, 1, 0), right_mtl);
     
     return cornell;
 }
@@ -116,10 +719,15 @@ Mesh Mesh::Parallelogram(
     const mtl::Material* mat
 ) {
     Mesh mesh;
-    // mirror point A over edge BC
+    // mirror point A over edge BC, both
+    // triangles share the edge BC
     Vec3f D = B + C - A;
-    mesh.push_back(new Triangle(A, B, C, mat));
-    mesh.push_back(new Triangle(D, C, B, mat));
+    uint32_t a = mesh.add_vertex(A);
+    uint32_t b = mesh.add_vertex(B);
+    uint32_t c = mesh.add_vertex(C);
+    uint32_t d = mesh.add_vertex(D);
+    mesh.add_triangle(a, b, c, mat);
+    mesh.add_triangle(d, c, b, mat);
     // return mesh
     return mesh;
 }
@@ -134,7 +742,7 @@ Mesh Mesh::Parallelepiped(
     // create a mesh and reserve
     // space for the triangles
     Mesh mesh;
-    mesh.reserve(2 * 6);
+    mesh.reserve(4 * 6, 2 * 6);
     // top and bottom
     Vec3f AD = D - A;
     mesh.extend(Mesh::Parallelogram(A, B, C, mat));
@@ -151,34 +759,182 @@ Mesh Mesh::Parallelepiped(
     return mesh;
 }
 
+/*
+ *  Construction and Access
+ */
+
+uint32_t Mesh::material_id(const mtl::Material* mat)
+{
+    // meshes usually hold only very few
+    // materials, thus a linear search is fine
+    std::vector<const mtl::Material*>::iterator it = std::find(_materials.begin(), _materials.end(), mat);
+    if (it != _materials.end()) { return it - _materials.begin(); }
+    // add the new material
+    _materials.push_back(mat);
+    return _materials.size() - 1;
+}
+
+void Mesh::drop_invalid_triangles(void)
+{
+    // move all valid triangles to the front
+    size_t n = 0;
+    for (size_t t = 0; t < _indices.size() / 3; t++) {
+        const uint32_t* c = &_indices[3 * t];
+        if ((c[0] >= _vertices.size()) || (c[1] >= _vertices.size()) || (c[2] >= _vertices.size())) { continue; }
+        if (!_texcoords.empty()) {
+            std::copy(&_texcoords[3 * t], &_texcoords[3 * t] + 3, &_texcoords[3 * n]);
+        }
+        std::copy(c, c + 3, &_indices[3 * n++]);
+    }
+    _indices.resize(3 * n);
+    if (!_texcoords.empty()) { _texcoords.resize(3 * n); }
+}
+
+void Mesh::reserve(
+    const size_t& n_vertices,
+    const size_t& n_triangles
+) {
+    _vertices.reserve(n_vertices);
+    _indices.reserve(3 * n_triangles);
+    _mtl_ids.reserve(n_triangles);
+}
+
+uint32_t Mesh::add_vertex(const Vec3f& v)
+{
+    _vertices.push_back(v);
+    return _vertices.size() - 1;
+}
+
+void Mesh::add_triangle(
+    const uint32_t& i,
+    const uint32_t& j,
+    const uint32_t& k,
+    const mtl::Material* mat
+) {
+    _indices.push_back(i);
+    _indices.push_back(j);
+    _indices.push_back(k);
+    _mtl_ids.push_back(material_id(mat));
+    // keep the texture coordinates aligned
+    if (!_texcoords.empty()) { _texcoords.insert(_texcoords.end(), corner_uv, corner_uv + 3); }
+}
+
+void Mesh::add_triangle(
+    const Vec3f& A,
+    const Vec3f& B,
+    const Vec3f& C,
+    const mtl::Material* mat
+) {
+    // add the corners as new vertices
+    uint32_t i = add_vertex(A);
+    uint32_t j = add_vertex(B);
+    uint32_t k = add_vertex(C);
+    add_triangle(i, j, k, mat);
+}
+
+void Mesh::init_texcoords(void)
+{
+    if (!_texcoords.empty()) { return; }
+    _texcoords.reserve(3 * size());
+    for (size_t t = 0; t < size(); t++) {
+        _texcoords.insert(_texcoords.end(), corner_uv, corner_uv + 3);
+    }
+}
+
+void Mesh::set_texcoords(
+    const size_t& t,
+    const txr::TexCoord& a,
+    const txr::TexCoord& b,
+    const txr::TexCoord& c
+) {
+    init_texcoords();
+    _texcoords[3 * t + 0] = a;
+    _texcoords[3 * t + 1] = b;
+    _texcoords[3 * t + 2] = c;
+}
+
+size_t Mesh::size(void) const { return _mtl_ids.size(); }
+size_t Mesh::n_vertices(void) const { return _vertices.size(); }
+bool Mesh::has_texcoords(void) const { return !_texcoords.empty(); }
+const std::vector<Vec3f>& Mesh::vertices(void) const { return _vertices; }
+const std::vector<uint32_t>& Mesh::indices(void) const { return _indices; }
+
+const Vec3f& Mesh::vertex(
+    const size_t& t,
+    const size_t& k
+) const {
+    return _vertices[_indices[3 * t + k]];
+}
+
+const mtl::Material* Mesh::material(const size_t& t) const {
+    return _materials[_mtl_ids[t]];
+}
+
+const txr::TexCoord& Mesh::texcoord(
+    const size_t& t,
+    const size_t& k
+) const {
+    return _texcoords.empty()? corner_uv[k] : _texcoords[3 * t + k];
+}
+
+AABB Mesh::bound(const size_t& t) const
+{
+    // build a bounding box containing all
+    // three corner points of the triangle
+    const Vec3f& A = vertex(t, 0);
+    const Vec3f& B = vertex(t, 1);
+    const Vec3f& C = vertex(t, 2);
+    return AABB(
+        A.min(B.min(C)),
+        A.max(B.max(C))
+    );
+}
+
 /*
  *  Helpers
  */
 
-void Mesh::extend(const std::vector<Triangle*>& other) {
-    insert(begin(), other.begin(), other.end());
+void Mesh::extend(const Mesh& other) {
+    // append the vertices and shift the indices
+    // of the other mesh behind the own vertices
+    uint32_t offset = _vertices.size();
+    _vertices.insert(_vertices.end(), other._vertices.begin(), other._vertices.end());
+    for (const uint32_t& i : other._indices) { _indices.push_back(offset + i); }
+    // map the material ids to the own table
+    for (const uint32_t& id : other._mtl_ids) {
+        _mtl_ids.push_back(material_id(other._materials[id]));
+    }
+    // append the texture coordinates if any of
+    // both meshes has texture coordinates
+    if (!_texcoords.empty() || !other._texcoords.empty()) {
+        size_t n = size() - other.size();
+        if (_texcoords.empty()) {
+            for (size_t t = 0; t < n; t++) { _texcoords.insert(_texcoords.end(), corner_uv, corner_uv + 3); }
+        }
+        for (size_t t = 0; t < other.size(); t++) {
+            for (size_t k = 0; k < 3; k++) { _texcoords.push_back(other.texcoord(t, k)); }
+        }
+    }
 }
 
 Mesh& Mesh::swap_axes(
     const size_t& i,
     const size_t& j
 ) {
-    // swap the dimensions of the vertices of each triangle 
-    // (note that Mesh is a friend of triangle)
-    for (Triangle* t : *this) {
-        std::swap(t->A[i], t->A[j]);
-        std::swap(t->B[i], t->B[j]);
-        std::swap(t->C[i], t->C[j]);
+    // swap the dimensions of each vertex
+    for (Vec3f& v : _vertices) {
+        std::swap(v[i], v[j]);
     }
     return *this;
 }
 
 Mesh& Mesh::flip_normals(void)
 {
-    // swap the dimensions of the vertices of each triangle 
-    // (note that Mesh is a friend of triangle)
-    for (Triangle* t : *this) {
-        std::swap(t->B, t->C);
+    // swap the last two corners of each
+    // triangle to flip its orientation
+    for (size_t t = 0; t < size(); t++) {
+        std::swap(_indices[3 * t + 1], _indices[3 * t + 2]);
+        if (!_texcoords.empty()) { std::swap(_texcoords[3 * t + 1], _texcoords[3 * t + 2]); }
     }
     return *this;
 }
@@ -186,37 +942,28 @@ Mesh& Mesh::flip_normals(void)
 Mesh& Mesh::mirror(
     const size_t& axis
 ) {
-    // swap the dimensions of the vertices of each triangle 
-    // (note that Mesh is a friend of triangle)
-    for (Triangle* t : *this) {
-        t->A[axis] *= -1;
-        t->B[axis] *= -1;
-        t->C[axis] *= -1;
+    // mirror each vertex along the given axis
+    for (Vec3f& v : _vertices) {
+        v[axis] *= -1;
     }
     return *this;
 }
 
 Mesh& Mesh::translate(const Vec3f& off)
 {
-    // translate the vertices of each triangle 
-    // (note that Mesh is a friend of triangle)
-    for (Triangle* t : *this) {
-        t->A = t->A + off;
-        t->B = t->B + off;
-        t->C = t->C + off;
+    // translate each vertex
+    for (Vec3f& v : _vertices) {
+        v = v + off;
     }
     return *this;
 }
 
 Mesh& Mesh::scale(const float& value)
 {
-    // scale the vertices of each triangle
-    // (note that Mesh is a friend of triangle)
+    // scale each vertex
     Vec3f vec_value(value);
-    for (Triangle* t : *this) {
-        t->A = t->A * vec_value;
-        t->B = t->B * vec_value;
-        t->C = t->C * vec_value;
+    for (Vec3f& v : _vertices) {
+        v = v * vec_value;
     }
     return *this;
 }
@@ -228,17 +975,17 @@ Mesh& Mesh::fit_box(
     // initial mean
     Vec3f mean = Vec3f::zeros;
     // initial low and high    
-    Triangle* t = this->at(0);
-    Vec3f low = t->A.min(t->B.min(t->C));
-    Vec3f high = t->A.max(t->B.max(t->C));
-    // compute mean, low and high over all
-    // triangles in the mesh
-    for (Triangle* t : *this) {
+    Vec3f low = _vertices[_indices[0]];
+    Vec3f high = _vertices[_indices[0]];
+    // compute mean, low and high over the
+    // corners of all triangles in the mesh
+    for (const uint32_t& i : _indices) {
+        const Vec3f& v = _vertices[i];
         // sum all together
-        mean = mean + t->A + t->B + t->C;
+        mean = mean + v;
         // update low and high values
-        low = low.min(t->A.min(t->B.min(t->C)));
-        high = high.max(t->A.max(t->B.max(t->C)));
+        low = low.min(v);
+        high = high.max(v);
     }
     // compute mean of mesh and box
     mean = mean / (size() * 3.0f);
@@ -254,11 +1001,10 @@ Mesh& Mesh::fit_box(
     // filled
     Vec3f box_diff = a.max(b) - a.min(b);
     float scale_val = box_diff[axis] / diff[axis];
-    // apply translation and scaling to all triangles
+    // apply translation and scaling to all vertices
     translate(-1.0f * mean);
     scale(scale_val);
     translate(box_mean);
     // return mesh
     return *this;
 }
-
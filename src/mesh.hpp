@@ -1,26 +1,73 @@
 #ifndef H_MESH
 #define H_MESH
 
-// forward declarations
-class Triangle;
 // includes
 #include <vector>
+#include <cstdint>
 #include "./vec.hpp"
+#include "./bvh.hpp"
 #include "./material.hpp"
 
-class Mesh : public std::vector<Triangle*> {
+// indexed triangle mesh, all triangles share a single
+// vertex buffer and refer to their corners by index
+class Mesh {
+private:
+    // the shared vertex buffer
+    std::vector<Vec3f> _vertices;
+    // three vertex indices per triangle
+    std::vector<uint32_t> _indices;
+    // the material of each triangle given
+    // as index into the material table
+    std::vector<uint32_t> _mtl_ids;
+    std::vector<const mtl::Material*> _materials;
+    // texture coordinates of the three corners
+    // of each triangle, empty if the mesh has none
+    std::vector<txr::TexCoord> _texcoords;
+    // give each triangle texture coordinates
+    // if the mesh does not have any yet
+    void init_texcoords(void);
+    // get the id of a material and add it
+    // to the table if it is not yet known
+    uint32_t material_id(const mtl::Material* mat);
+    // remove all entries of the index array that refer to vertices
+    // that do not exist together with their texture coordinates,
+    // used by the loaders before the material ids are assigned
+    void drop_invalid_triangles(void);
 public:
     // constructor
     Mesh(void) = default;
-    Mesh(
-        const Mesh::const_iterator& begin,
-        const Mesh::const_iterator& end
-    );
     // initializers
     static Mesh load_obj(
         const char* fpath,
         const mtl::Material* mat
     );
+    // binary mesh cache holding the vertex, index, material id
+    // and texture coordinate arrays as they are stored in memory,
+    // the material ids index the material table given when
+    // loading the cache, the size and modification time of
+    // the source file are stored if one is given and a cache
+    // of another version of the source is not loaded
+    bool save_cache(
+        const char* fpath,
+        const char* source_fpath = nullptr
+    ) const;
+    static Mesh load_cache(
+        const char* fpath,
+        const std::vector<const mtl::Material*>& materials,
+        const char* source_fpath = nullptr
+    );
+    // load a binary ply file in little or big endian
+    static Mesh load_ply(
+        const char* fpath,
+        const mtl::Material* mat
+    );
+    // load the cache if it is valid and otherwise
+    // parse the obj file and write the cache
+    static Mesh load_obj_cached(
+        const char* obj_fpath,
+        const char* cache_fpath,
+        const mtl::Material* mat
+    );
     static Mesh CornellBox(
         const mtl::Material* base_mtl,
         const mtl::Material* left_mtl,
@@ -40,8 +87,46 @@ public:
         const Vec3f& D,
         const mtl::Material* mat
     );
+    // build the mesh, adding a triangle by its corners
+    // gives it its own vertices which are not shared
+    void reserve(const size_t& n_vertices, const size_t& n_triangles);
+    uint32_t add_vertex(const Vec3f& v);
+    void add_triangle(
+        const uint32_t& i,
+        const uint32_t& j,
+        const uint32_t& k,
+        const mtl::Material* mat
+    );
+    void add_triangle(
+        const Vec3f& A,
+        const Vec3f& B,
+        const Vec3f& C,
+        const mtl::Material* mat
+    );
+    // set the texture coordinates of the corners of the triangle
+    // with index t, triangles without texture coordinates use
+    // the barycentric coordinates of their corners
+    void set_texcoords(
+        const size_t& t,
+        const txr::TexCoord& a,
+        const txr::TexCoord& b,
+        const txr::TexCoord& c
+    );
+    // number of triangles and vertices
+    size_t size(void) const;
+    size_t n_vertices(void) const;
+    bool has_texcoords(void) const;
+    // getters
+    const std::vector<Vec3f>& vertices(void) const;
+    const std::vector<uint32_t>& indices(void) const;
+    // get the k-th corner, the material and the
+    // bounding box of the triangle with index t
+    const Vec3f& vertex(const size_t& t, const size_t& k) const;
+    const mtl::Material* material(const size_t& t) const;
+    const txr::TexCoord& texcoord(const size_t& t, const size_t& k) const;
+    AABB bound(const size_t& t) const;
     // some helpers
-    void extend(const std::vector<Triangle*>& other);
+    void extend(const Mesh& other);
     Mesh& swap_axes(const size_t& i, const size_t& j);
     Mesh& flip_normals(void);
     Mesh& mirror(const size_t& axis);
@@ -1,113 +1,9 @@
 #include "./primitive.hpp"
-#include "./ray.hpp"
-#include "./mesh.hpp"
 #include <algorithm>
 #include <numeric>
 #include <queue>
 #include <math.h>
 
-// helper functions for packet vectors
-inline void cross(
-    std::array<Vec4f, 3>& result, 
-    const std::array<Vec4f, 3>& a, 
-    const std::array<Vec4f, 3>& b
-) {
-    result[0] = (a[1] * b[2]) - (a[2] * b[1]);
-    result[1] = (a[2] * b[0]) - (a[0] * b[2]);
-    result[2] = (a[0] * b[1]) - (a[1] * b[0]);
-}
-
-inline Vec4f dot(
-    const std::array<Vec4f, 3>& a, 
-    const std::array<Vec4f, 3>& b
-) {
-    return a[0].fmadd(b[0], a[1].fmadd(b[1], a[2] * b[2]));
-}
-
-inline void sub(
-    std::array<Vec4f, 3>& result,
-    const std::array<Vec4f, 3>& a,
-    const std::array<Vec4f, 3>& b
-) {
-    result[0] = a[0] - b[0];
-    result[1] = a[1] - b[1];
-    result[2] = a[2] - b[2];
-}
-
-
-/*
- *  Primitive Collection
- */
-
-bool PrimitiveCollection::cast(
-    const Ray& ray,
-    HitRecord& record
-) const {
-    // build ray-packet from ray
-    Ray4 ray_packet = {
-        { Vec4f(ray.origin[0]), Vec4f(ray.origin[1]), Vec4f(ray.origin[2]) },
-        { Vec4f(ray.direction[0]), Vec4f(ray.direction[1]), Vec4f(ray.direction[2]) }
-    }; 
-    // values to mark the current best hit
-    size_t i;                   // index of the triangle with the current best hit
-    float t = record.t;         // distance to the current closest intersection
-    bool hit = record.is_valid; // did the ray hit a triangle yet
-    // check all packets in list
-    for (size_t k = 0; k < n_packets(); k++) {
-        // cast the ray against the primitive packet
-        Vec4f ts = cast_ray_packet(ray_packet, k);
-        // find the closest primitive in packet
-        // intersecting with the ray
-        for (size_t j = 0; j < 4; j++) {
-            // update the current best if both
-            //  - the ray intersects with the current primitive
-            //  - the intersection point is closer than the current best
-            if ((ts[j] > 0) && ((ts[j] < t) || (!hit))) { 
-                t = ts[j];
-                i = k * 4 + j;
-                hit = true; 
-            }
-        }
-    }
-    // check if the ray did hit any of the primitives
-    // in the collection
-    if (hit) {
-        // compute the point of intersection
-        Vec3f p = Vec3f(t).fmadd(ray.direction, ray.origin);
-        // update the hitrecord accordingly
-        record = { t, p, get_normal(i, p), ray.direction, true, get_material(i) };
-    }
-    // indicate that the ray indeed hit
-    // a primitive in the collection
-    return hit;
-}
-
-/*
- *  Primitive List
- */
-
-bool PrimitiveList::cast(
-    const Ray& ray,
-    HitRecord& record
-) const {
-    // values to mark the current best hit
-    bool hit = false;
-    HitRecord tmp;
-    // check all primitives in the list
-    for (const Primitive* prim : *this) {
-        // cast ray against the primitive
-        // and update the hitrecord if neccessary
-        if (prim->cast(ray, tmp) && (
-                (tmp.is_valid && !record.is_valid) ||
-                (tmp.is_valid && record.is_valid && (record.t > tmp.t))
-        )) { record = tmp; hit = true; }
-        // reset temporary hitrecord
-        tmp.is_valid = false;
-    }
-    return hit;
-}
-
-
 /*
  *  Triangle
  */
@@ -136,101 +32,149 @@ AABB Triangle::bound(void) const
  * Triangle Collection
  */
 
-TriangleCollection::TriangleCollection(
-    const std::vector<Triangle>::const_iterator& begin,
-    const std::vector<Triangle>::const_iterator& end
+// write the given components into the lane i of
+// the last packet, a new packet is filled entirely
+// with the given components
+template<size_t N>
+static void push_lane(
+    Buffer<std::array<Vec4f, N>>& packets,
+    const size_t& i,
+    const std::array<float, N>& values
 ) {
-    // push each triangle in the iterator
-    // onto the collection
-    std::for_each(begin, end, [this](const Triangle& t) { push_back(t); });
+    if (i == 0) { packets.emplace_back(); }
+    for (size_t k = 0; k < N; k++) {
+        if (i == 0) { packets.back()[k] = Vec4f(values[k]); }
+        else { packets.back()[k][i] = values[k]; }
+    }
 }
 
-Vec3f TriangleCollection::get_normal(
-    const size_t& i,    // index of the primitive
-    const Vec3f& p      // point on surface
-) const {
-    return Ns[i];
+// get the id of a material in the given table
+// and add it to the table if it is not yet known
+static uint32_t material_id(
+    std::vector<const mtl::Material*>& materials,
+    const mtl::Material* mtl
+) {
+    // search from the back as consecutive
+    // primitives mostly share their material
+    for (size_t k = materials.size(); k > 0; k--) {
+        if (materials[k - 1] == mtl) { return k - 1; }
+    }
+    materials.push_back(mtl);
+    return materials.size() - 1;
 }
 
-const mtl::Material* TriangleCollection::get_material(
-    const size_t& i
-) const {
-    return mtls[i];
+TriangleCollection::TriangleCollection(const TriangleKernel& kernel) :
+    _kernel(kernel)
+{
 }
 
-Vec4f TriangleCollection::cast_ray_packet(
-    const Ray4& ray,
-    const size_t& i
-) const {
-    // Möller–Trumbore intersection algorithm
-    // using simd instructions for parallel
-    // processing of triangles rays at once
-    
-    // gather all information needed to cast the
-    // ray against the current triangle packet
-    const std::array<Vec4f, 3>& A = As[i];
-    const std::array<Vec4f, 3>& U = Us[i];
-    const std::array<Vec4f, 3>& V = Vs[i];
-    
-    // check if the ray is parallel to triangle 
-    std::array<Vec4f, 3> h; cross(h, ray.direction, V); 
-    Vec4f a = dot(U, h);
-    Vec4f mask1 = (a < Vec4f::neps) | (Vec4f::eps < a);
-    // check if intersection in
-    // range of first edge
-    Vec4f f = Vec4f::ones / a;
-    std::array<Vec4f, 3> s; sub(s, ray.origin, A);
-    Vec4f u = dot(s, h) * f;
-    Vec4f mask2 = (Vec4f::zeros < u) & (u < Vec4f::ones);
-    // check if intersection is
-    // in range of both edges
-    std::array<Vec4f, 3> q; cross(q, s, U);
-    Vec4f v = dot(ray.direction, q) * f;
-    Vec4f mask3 = (Vec4f::zeros < v) & ((u + v) < Vec4f::ones);
-    // compute the distance between the origin
-    // of the ray and the intersection point
-    // and make sure it is in front of the ray
-    Vec4f ts = dot(V, q) * f;
-    Vec4f mask4 = (Vec4f::eps < ts);
-    // mark invalids
-    ts = ts.take(-1 * Vec4f::ones, -1 * (mask1 & mask2 & mask3 & mask4));
-    return ts;
-}
+const TriangleKernel& TriangleCollection::kernel(void) const { return _kernel; }
 
 void TriangleCollection::push_back(const Triangle& T) 
 {
+    push_back(T.A, T.B, T.C, T.mtl);
+}
+
+void TriangleCollection::push_back(
+    const Vec3f& A,
+    const Vec3f& B,
+    const Vec3f& C,
+    const mtl::Material* mtl,
+    const TriangleUV& uv
+) {
     // compute the spanning vectors
-    Vec3f u = T.B - T.A;
-    Vec3f v = T.C - T.A;
-    // check if a new triangle packet is
-    // needed for the given triangle
+    Vec3f u = B - A;
+    Vec3f v = C - A;
+    Vec3f n = u.cross(v);
+    // lane of the triangle in the currently
+    // last packet, zero starts a new packet
     size_t i = n_triangles++ % 4;
-    if (i == 0) {
-        // add a new packet filled with
-        // the same triangle
-        As.push_back({ Vec4f(T.A[0]), Vec4f(T.A[1]), Vec4f(T.A[2]) });
-        Us.push_back({ Vec4f(u[0]), Vec4f(u[1]), Vec4f(u[2]) });
-        Vs.push_back({ Vec4f(v[0]), Vec4f(v[1]), Vec4f(v[2]) });
-    } else {
-        // insert the triangle into the
-        // currently last packet
-        As.back()[0][i] = T.A[0];
-        As.back()[1][i] = T.A[1];
-        As.back()[2][i] = T.A[2];
-        Us.back()[0][i] = u[0];
-        Us.back()[1][i] = u[1];
-        Us.back()[2][i] = u[2];
-        Vs.back()[0][i] = v[0];
-        Vs.back()[1][i] = v[1];
-        Vs.back()[2][i] = v[2];
+    // insert the triangle data
+    // required by the kernel
+    switch (_kernel) {
+        case TriangleKernel::MollerTrumbore: {
+            push_lane<3>(As, i, { A[0], A[1], A[2] });
+            push_lane<3>(Us, i, { u[0], u[1], u[2] });
+            push_lane<3>(Vs, i, { v[0], v[1], v[2] });
+            break;
+        }
+        case TriangleKernel::Watertight: {
+            // store the corners as they are such that
+            // shared edges lead to the exact same
+            // edge functions in neighboring triangles
+            push_lane<3>(As, i, { A[0], A[1], A[2] });
+            push_lane<3>(Bs, i, { B[0], B[1], B[2] });
+            push_lane<3>(Cs, i, { C[0], C[1], C[2] });
+            break;
+        }
+        case TriangleKernel::Plane: {
+            // plane through the triangle and the planes
+            // through the edges AC and AB scaled such that
+            // they evaluate to one at the opposite corner
+            float inv_area = 1.0f / n.sq_norm()[0];
+            Vec3f n1 = v.cross(n) * inv_area;
+            Vec3f n2 = n.cross(u) * inv_area;
+            push_lane<12>(planes, i, {
+                n[0], n[1], n[2], n.dot(A)[0],
+                n1[0], n1[1], n1[2], -n1.dot(A)[0],
+                n2[0], n2[1], n2[2], -n2.dot(A)[0]
+            });
+            break;
+        }
+    }
+    // the texture coordinate density is the square root of
+    // the ratio between the areas in texture and world space
+    const txr::TexCoord* c = uv.corners;
+    float uv_area = fabsf((c[1].u - c[0].u) * (c[2].v - c[0].v) - (c[2].u - c[0].u) * (c[1].v - c[0].v));
+    float area = n.norm()[0];
+    TriangleUV tri_uv = uv;
+    tri_uv.density = (area > 0.0f)? sqrtf(uv_area / area) : 0.0f;
+    // push normal, texture coordinates and material
+    // which are not separated by components
+    Ns.push_back(n.normalize());
+    UVs.push_back(tri_uv);
+    mtl_ids.push_back(material_id(materials, mtl));
+}
+
+void TriangleCollection::close_packet(void)
+{
+    // the lanes of a new packet are initialized with
+    // its first triangle, thus only the per-lane normals
+    // and materials need to be padded
+    size_t first = n_triangles - n_triangles % 4;
+    while (n_triangles % 4 != 0) {
+        Ns.push_back(Ns[first]);
+        UVs.push_back(UVs[first]);
+        mtl_ids.push_back(mtl_ids[first]);
+        n_triangles++;
     }
-    // push normal and material which are not
-    // separated by components
-    Ns.push_back(u.cross(v).normalize());
-    mtls.push_back(T.mtl);
 }
 
-size_t TriangleCollection::n_packets(void) const { return As.size(); }
+void TriangleCollection::surface(
+    const Hit& hit,
+    const Vec3f& origin,
+    const Vec3f& direction,
+    HitRecord& record
+) const {
+    // compute the point of intersection
+    Vec3f p = Vec3f(hit.t).fmadd(direction, origin);
+    // interpolate the texture coordinates
+    // by the barycentric coordinates
+    const TriangleUV& uv = UVs[hit.prim_id];
+    float w = 1.0f - hit.u - hit.v;
+    txr::TexCoord tc = {
+        w * uv.corners[0].u + hit.u * uv.corners[1].u + hit.v * uv.corners[2].u,
+        w * uv.corners[0].v + hit.u * uv.corners[1].v + hit.v * uv.corners[2].v
+    };
+    // build the full hitrecord
+    record = { hit.t, p, Ns[hit.prim_id], direction, materials[mtl_ids[hit.prim_id]], tc, uv.density, 0.0f };
+}
+
+const mtl::Material* TriangleCollection::material(const Hit& hit) const {
+    return materials[mtl_ids[hit.prim_id]];
+}
+
+size_t TriangleCollection::n_packets(void) const { return (n_triangles + 3) / 4; }
 size_t TriangleCollection::n_primitives(void) const { return n_triangles; }
 
 /*
@@ -256,46 +200,6 @@ AABB Sphere::bound(void) const {
  * Sphere Collection
  */
 
-Vec4f SphereCollection::cast_ray_packet(
-    const Ray4& ray,
-    const size_t& i
-) const {
-    // gather all properties of the primitives
-    // in the packet indicated by the given index
-    const std::array<Vec4f, 3>& C = centers[i];
-    const Vec4f& R = radii[i];
-
-    // compute the distriminant
-    std::array<Vec4f, 3> oc; sub(oc, ray.origin, C);
-    Vec4f a = dot(ray.direction, ray.direction);
-    Vec4f b = dot(oc, ray.direction);
-    Vec4f c = dot(oc, oc) - (R * R);
-    Vec4f d = (b * b) - (a * c);
-    // compute distances
-    Vec4f d_sqrt = d.sqrt();
-    Vec4f ts = -1 * d_sqrt - b;
-    ts = ts.take(d_sqrt - b, ts < Vec4f::zeros) / a;
-    // mark invalids
-    ts = ts.take(-1 * Vec4f::ones, d < Vec4f::zeros);
-    // return distances
-    return ts;
-}
-
-Vec3f SphereCollection::get_normal(
-    const size_t& i,    // index of the primitive
-    const Vec3f& p      // point on surface
-) const {
-    size_t j = i / 4, k = i % 4;
-    Vec3f center(centers[j][0][k], centers[j][1][k], centers[j][2][k]);
-    return (p - center) / radii[j][k];
-}
-
-const mtl::Material* SphereCollection::get_material(
-    const size_t& i
-) const {
-    return mtls[i];
-}
-
 void SphereCollection::push_back(const Sphere& S) {
     // check if a new sphere packet is needed for
     // for the given sphere
@@ -312,7 +216,45 @@ void SphereCollection::push_back(const Sphere& S) {
         radii.back()[i] = S.radius;
     } 
     // push matrial to list
-    mtls.push_back(S.mtl);
+    mtl_ids.push_back(material_id(materials, S.mtl));
+}
+
+void SphereCollection::close_packet(void)
+{
+    // pad the materials of the last packet
+    size_t first = n_spheres - n_spheres % 4;
+    while (n_spheres % 4 != 0) {
+        mtl_ids.push_back(mtl_ids[first]);
+        n_spheres++;
+    }
+}
+
+void SphereCollection::surface(
+    const Hit& hit,
+    const Vec3f& origin,
+    const Vec3f& direction,
+    HitRecord& record
+) const {
+    // compute the point of intersection
+    Vec3f p = Vec3f(hit.t).fmadd(direction, origin);
+    // the normal points from the center
+    // of the sphere to the surface point
+    size_t j = hit.prim_id / 4, k = hit.prim_id % 4;
+    Vec3f center(centers[j][0][k], centers[j][1][k], centers[j][2][k]);
+    Vec3f n = (p - center) / radii[j][k];
+    // spherical texture coordinates where u runs around
+    // the y-axis once per circumference
+    txr::TexCoord tc = {
+        0.5f + atan2f(n[2], n[0]) / (2.0f * (float)M_PI),
+        0.5f - asinf(std::min(std::max(n[1], -1.0f), 1.0f)) / (float)M_PI
+    };
+    float density = 1.0f / (2.0f * (float)M_PI * radii[j][k]);
+    // build the full hitrecord
+    record = { hit.t, p, n, direction, materials[mtl_ids[hit.prim_id]], tc, density, 0.0f };
+}
+
+const mtl::Material* SphereCollection::material(const Hit& hit) const {
+    return materials[mtl_ids[hit.prim_id]];
 }
 
 size_t SphereCollection::n_packets(void) const { return centers.size(); }
@@ -2,18 +2,144 @@
 #define H_PRIMITIVE
 
 // forward declarations
-struct Ray;
-struct Ray4;
-class Mesh;
 class TriangleCollection;
 class SphereCollection;
+class Scene;
 // includes
 #include <array>
 #include <vector>
+#include <cmath>
+#include <cstdint>
+#include <utility>
 #include "./vec.hpp"
+#include "./ray.hpp"
+#include "./buffer.hpp"
 #include "./bvh.hpp"
 #include "./material.hpp"
 
+// helper functions for packet vectors
+inline void cross(
+    std::array<Vec4f, 3>& result, 
+    const std::array<Vec4f, 3>& a, 
+    const std::array<Vec4f, 3>& b
+) {
+    result[0] = (a[1] * b[2]) - (a[2] * b[1]);
+    result[1] = (a[2] * b[0]) - (a[0] * b[2]);
+    result[2] = (a[0] * b[1]) - (a[1] * b[0]);
+}
+
+inline Vec4f dot(
+    const std::array<Vec4f, 3>& a, 
+    const std::array<Vec4f, 3>& b
+) {
+    return a[0].fmadd(b[0], a[1].fmadd(b[1], a[2] * b[2]));
+}
+
+inline void sub(
+    std::array<Vec4f, 3>& result,
+    const std::array<Vec4f, 3>& a,
+    const std::array<Vec4f, 3>& b
+) {
+    result[0] = a[0] - b[0];
+    result[1] = a[1] - b[1];
+    result[2] = a[2] - b[2];
+}
+
+// closest-hit search over a sequence of primitive
+// packets of any simd width, the running minimum
+// distances, barycentric coordinates and packet
+// indices are kept in registers and only reduced
+// horizontally once all packets are processed, the
+// indices are stored as integer bits such that they
+// stay exact for any number of packets
+template<typename VecT>
+class ClosestHit {
+private:
+    VecT t, u, v, k;
+    // index of lanes that were never hit
+    static constexpr uint32_t no_packet = (uint32_t)-1;
+public:
+    // constructor
+    inline ClosestHit(const float& tmax) :
+        t(tmax), u(0.0f), v(0.0f), k(VecT::from_bits(no_packet)) {}
+    // update the lanes in which the given
+    // packet k holds a valid and closer hit
+    inline void update(
+        const VecT& ts,
+        const VecT& us,
+        const VecT& vs,
+        const size_t& packet
+    ) {
+        VecT mask = VecT::zeros.lt(ts) & ts.lt(t);
+        t = t.take(ts, mask);
+        u = u.take(us, mask);
+        v = v.take(vs, mask);
+        k = k.take(VecT::from_bits(packet), mask);
+    }
+    // reduce all lanes to the closest hit and
+    // return false if none of the lanes was hit
+    inline bool reduce(
+        float& best_t,
+        float& best_u,
+        float& best_v,
+        uint32_t& best_id
+    ) const {
+        // find the first lane holding the minimum
+        // distance, note that lanes that were never
+        // updated still hold the initial distance
+        unsigned int lane = __builtin_ctz(t.eq(t.hmin()).movemask());
+        if (k.bits(lane) == no_packet) { return false; }
+        best_t = t[lane];
+        best_u = u[lane];
+        best_v = v[lane];
+        best_id = k.bits(lane) * VecT::width + lane;
+        return true;
+    }
+};
+
+// cast a ray against a range of packets of a
+// primitive collection and update the hit if
+// the closest of them is closer than the hit,
+// note that the kernel of the collection is
+// called directly and thus can be inlined
+template<PrimitiveType type, typename Kernel>
+inline bool cast_packets(
+    const Kernel& kernel,
+    const size_t& begin,
+    const size_t& end,
+    Hit& hit
+) {
+    // keep the closest hits of all lanes
+    // in registers while iterating the packets
+    ClosestHit<Vec4f> closest(hit.t);
+    for (size_t k = begin; k < end; k++) {
+        Vec4f us, vs;
+        Vec4f ts = kernel(k, us, vs);
+        closest.update(ts, us, vs, k);
+    }
+    // reduce the lanes to the closest hit
+    if (closest.reduce(hit.t, hit.u, hit.v, hit.prim_id)) {
+        hit.type = type;
+        return true;
+    }
+    return false;
+}
+
+template<typename Collection>
+inline bool cast_packets(
+    const Collection& coll,
+    const Ray4& ray,
+    const size_t& begin,
+    const size_t& end,
+    Hit& hit
+) {
+    // use the default kernel of the collection
+    return cast_packets<Collection::type>(
+        [&](const size_t& k, Vec4f& us, Vec4f& vs) { return coll.cast_ray_packet(ray, k, us, vs); },
+        begin, end, hit
+    );
+}
+
 // hit record storing infromation
 // about the intersection of a ray
 // with a primitive
@@ -22,80 +148,80 @@ typedef struct HitRecord {
     Vec3f p;    // point of intersection
     Vec3f n;    // surface normal at intersection
     Vec3f v;    // direction of incident ray
-    bool is_valid = false;      // is the hit valid
     const mtl::Material* mat;   // surface material
+    txr::TexCoord uv;           // texture coordinates
+    float uv_density;           // texture space length per unit length
+    float footprint;            // width of the ray footprint
 } HitRecord;
 
 
 /*
- *  Primitive
+ *  Triangle
  */
 
-// abstract class defining the interface
-// a primitive must follow
-class Primitive {
-public:
-    // cast a given ray to the primitive
-    // and receive a hitrecord
-    virtual bool cast(
-        const Ray& ray,
-        HitRecord& record
-    ) const = 0;
-    // virtual destructor
-    virtual ~Primitive(void) = default;
+// available ray-triangle intersection kernels
+enum class TriangleKernel {
+    MollerTrumbore, // möller-trumbore test with epsilon bounds
+    Watertight,     // watertight test shearing the triangles into ray space
+    Plane           // precomputed plane equations and inverse area terms
 };
 
+// per-ray constants of the watertight test, i.e. the
+// permutation making the z-axis the dominant direction
+// and the shear aligning the ray with that axis
+typedef struct ShearedRay {
+    size_t kx, ky, kz;
+    Vec4f Sx, Sy, Sz;
+} ShearedRay;
 
-// abstract primitive class handeling a collection
-// of the same primitive type (e.g. triangle, sphere)
-class PrimitiveCollection : public Primitive {
-private:
-    // cast a ray against a packet of
-    // primitives in the collection
-    virtual Vec4f cast_ray_packet(
-        const Ray4& ray,    // packet of the same ray
-        const size_t& i     // index of the primitive packet
-    ) const = 0;
-    // get the normal of a primitive at
-    // the given point on its surface
-    virtual Vec3f get_normal(
-        const size_t& i,    // index of the primitive
-        const Vec3f& p      // point on surface
-    ) const = 0;
-    // get the material of a primitive
-    virtual const mtl::Material* get_material(const size_t& i) const = 0;
-public:
-    // override cast function to process
-    // multiple triangles at once using
-    // simd instructions
-    bool cast(
-        const Ray& ray,
-        HitRecord& record
-    ) const;
-    // total number of primitive packets
-    // currently stored in the collection
-    virtual size_t n_packets(void) const = 0;
-    // total number of primtives stored
-    virtual size_t n_primitives(void) const = 0; 
-};
+// edge function ax * by - ay * bx evaluated in double precision,
+// the products of floats are exact in double such that swapping
+// the corners always gives exactly the negated value (even
+// if the compiler contracts the difference into a fma)
+inline Vec4f edge_function(
+    const Vec4f& ax,
+    const Vec4f& ay,
+    const Vec4f& bx,
+    const Vec4f& by
+) {
+#ifdef __AVX__
+    __m256d p = _mm256_mul_pd(_mm256_cvtps_pd(ax), _mm256_cvtps_pd(by));
+    __m256d q = _mm256_mul_pd(_mm256_cvtps_pd(ay), _mm256_cvtps_pd(bx));
+    return _mm256_cvtpd_ps(_mm256_sub_pd(p, q));
+#else
+    // lower and upper half separately
+    __m128d pl = _mm_mul_pd(_mm_cvtps_pd(ax), _mm_cvtps_pd(by));
+    __m128d ql = _mm_mul_pd(_mm_cvtps_pd(ay), _mm_cvtps_pd(bx));
+    __m128d ph = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(ax, ax)), _mm_cvtps_pd(_mm_movehl_ps(by, by)));
+    __m128d qh = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(ay, ay)), _mm_cvtps_pd(_mm_movehl_ps(bx, bx)));
+    return _mm_movelh_ps(_mm_cvtpd_ps(_mm_sub_pd(pl, ql)), _mm_cvtpd_ps(_mm_sub_pd(ph, qh)));
+#endif
+}
 
-// shortcut for a list of primitives
-class PrimitiveList : 
-    public std::vector<Primitive*>, 
-    public Primitive
+inline ShearedRay shear_ray(const Ray4& ray)
 {
-public:
-    // cast ray against all primitives in
-    // the list and return the closest hit
-    bool cast(
-        const Ray& ray,
-        HitRecord& record
-    ) const;
-};
+    // find the dominant axis of the direction
+    float d[3] = { ray.direction[0][0], ray.direction[1][0], ray.direction[2][0] };
+    size_t kz = (fabsf(d[0]) > fabsf(d[1]))?
+        ( (fabsf(d[0]) > fabsf(d[2]))? 0 : 2 ) :
+        ( (fabsf(d[1]) > fabsf(d[2]))? 1 : 2 ) ;
+    size_t kx = (kz + 1) % 3, ky = (kx + 1) % 3;
+    // swap to preserve the winding
+    if (d[kz] < 0.0f) { std::swap(kx, ky); }
+    // shear constants
+    return { kx, ky, kz, Vec4f(d[kx] / d[kz]), Vec4f(d[ky] / d[kz]), Vec4f(1.0f / d[kz]) };
+}
 
-/*
- *  Triangle
- */
+// texture coordinates of the corners of a triangle and the
+// ratio between lengths in texture space and world space
+typedef struct TriangleUV {
+    txr::TexCoord corners[3];
+    float density;
+} TriangleUV;
+
+// the barycentric coordinates of the corners used
+// for triangles without texture coordinates
+const TriangleUV barycentric_uv = { { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f } }, 0.0f };
 
 // triangle class implementing a boundable
 // object but not a primitive (rendering
@@ -116,57 +242,289 @@ public:
     // build bounding box completly
     // containing the triangle
     virtual AABB bound(void) const;
-    // allow triangle collection and mesh to
-    // access private members of a triangle
+    // allow triangle collection to access
+    // private members of a triangle
     friend TriangleCollection;
-    friend Mesh;
 };
 
-// combine a number of triangles into a
-// single primitive for more efficient
-// memory usage and computations
-class TriangleCollection : public PrimitiveCollection {
+// flat array of triangle packets, the triangles
+// of different leafs never share a packet such
+// that each leaf refers to a range of packets
+class TriangleCollection {
 private:
+    // the intersection kernel which also
+    // defines the layout of the packets
+    TriangleKernel _kernel;
     // the data of all the triangle packets
-    // separated into the single components
-    std::vector<std::array<Vec4f, 3>> As, Us, Vs;
-    // the normal vectors and materials
-    // of all triangle packet
-    std::vector<Vec3f> Ns;
-    std::vector<const mtl::Material*> mtls;
-    // the size of the collection
+    // separated into the single components:
+    //  - möller-trumbore: corner A and the edges U, V
+    //  - watertight: the three corners A, B, C
+    //  - plane: normal, offset and both edge planes
+    Buffer<std::array<Vec4f, 3>> As, Us, Vs;
+    Buffer<std::array<Vec4f, 3>> Bs, Cs;
+    Buffer<std::array<Vec4f, 12>> planes;
+    // the normal vectors, texture coordinates and
+    // material ids of all triangles including the
+    // padding lanes, the ids index the material table
+    Buffer<Vec3f> Ns;
+    Buffer<TriangleUV> UVs;
+    Buffer<uint32_t> mtl_ids;
+    std::vector<const mtl::Material*> materials;
+    // the number of used lanes
     size_t n_triangles = 0;
-    // function to cast a ray to a single
-    // packet of traingles
-    Vec4f cast_ray_packet(
-        const Ray4& ray,
-        const size_t& i
-    ) const;
-    // get the normal of a primitive at
-    // the given point on its surface
-    Vec3f get_normal(
-        const size_t& i,    // index of the primitive
-        const Vec3f& p      // point on surface
-    ) const;
-    // get the material of a primitive
-    const mtl::Material* get_material(const size_t& i) const;
+    // allow the scene to store the
+    // packets in a snapshot
+    friend Scene;
 public:
+    // the type of primitive stored
+    static constexpr PrimitiveType type = PrimitiveType::Triangle;
     // constructors
-    TriangleCollection(void) = default;
-    TriangleCollection(
-        const std::vector<Triangle>::const_iterator& begin,
-        const std::vector<Triangle>::const_iterator& end
-    );
+    TriangleCollection(const TriangleKernel& kernel = TriangleKernel::MollerTrumbore);
+    // get the intersection kernel
+    const TriangleKernel& kernel(void) const;
     // add a triangle to the collection
     // by pushing it into a packet
     void push_back(const Triangle& T);
+    void push_back(
+        const Vec3f& A,
+        const Vec3f& B,
+        const Vec3f& C,
+        const mtl::Material* mtl,
+        const TriangleUV& uv = barycentric_uv
+    );
+    // pad the last packet with copies of its
+    // first triangle such that the next triangle
+    // starts a new packet
+    void close_packet(void);
+    // cast a ray against a single packet
+    // of triangles and return the distances
+    // and barycentric coordinates of the hits
+    inline Vec4f cast_ray_packet(
+        const Ray4& ray,
+        const size_t& i,
+        Vec4f& u,
+        Vec4f& v
+    ) const;
+    // same as above using the watertight
+    // test for a previously sheared ray
+    inline Vec4f cast_ray_packet_watertight(
+        const Ray4& ray,
+        const ShearedRay& sheared,
+        const size_t& i,
+        Vec4f& u,
+        Vec4f& v
+    ) const;
+    // same as above using the
+    // precomputed plane equations
+    inline Vec4f cast_ray_packet_plane(
+        const Ray4& ray,
+        const size_t& i,
+        Vec4f& u,
+        Vec4f& v
+    ) const;
+    // cast a ray against the given range of
+    // packets using the kernel of the collection
+    inline bool cast(
+        const Ray4& ray,
+        const size_t& begin,
+        const size_t& end,
+        Hit& hit
+    ) const;
+    // hint the caches to load the components of the
+    // i-th packet that are read by the kernel
+    inline void prefetch(const size_t& i) const;
+    // reconstruct the full hit record
+    // of the given hit
+    void surface(
+        const Hit& hit,
+        const Vec3f& origin,
+        const Vec3f& direction,
+        HitRecord& record
+    ) const;
+    // the material of the primitive of the given hit
+    // without reconstructing the full hit record
+    const mtl::Material* material(const Hit& hit) const;
     // total number of primitive packets
     // currently stored in the collection
     size_t n_packets(void) const;
     // total number of primtives stored
+    // including the padding lanes
     size_t n_primitives(void) const; 
 };
 
+inline Vec4f TriangleCollection::cast_ray_packet(
+    const Ray4& ray,
+    const size_t& i,
+    Vec4f& u,
+    Vec4f& v
+) const {
+    // Möller–Trumbore intersection algorithm
+    // using simd instructions for parallel
+    // processing of triangles rays at once
+    
+    // gather all information needed to cast the
+    // ray against the current triangle packet
+    const std::array<Vec4f, 3>& A = As[i];
+    const std::array<Vec4f, 3>& U = Us[i];
+    const std::array<Vec4f, 3>& V = Vs[i];
+    
+    // check if the ray is parallel to triangle 
+    std::array<Vec4f, 3> h; cross(h, ray.direction, V); 
+    Vec4f a = dot(U, h);
+    Vec4f mask1 = (a < Vec4f::neps) | (Vec4f::eps < a);
+    // check if intersection in
+    // range of first edge
+    Vec4f f = Vec4f::ones / a;
+    std::array<Vec4f, 3> s; sub(s, ray.origin, A);
+    u = dot(s, h) * f;
+    Vec4f mask2 = (Vec4f::zeros < u) & (u < Vec4f::ones);
+    // check if intersection is
+    // in range of both edges
+    std::array<Vec4f, 3> q; cross(q, s, U);
+    v = dot(ray.direction, q) * f;
+    Vec4f mask3 = (Vec4f::zeros < v) & ((u + v) < Vec4f::ones);
+    // compute the distance between the origin
+    // of the ray and the intersection point
+    // and make sure it is in front of the ray
+    Vec4f ts = dot(V, q) * f;
+    Vec4f mask4 = (Vec4f::eps < ts);
+    // mark invalids
+    ts = ts.take(-1 * Vec4f::ones, -1 * (mask1 & mask2 & mask3 & mask4));
+    return ts;
+}
+
+inline Vec4f TriangleCollection::cast_ray_packet_watertight(
+    const Ray4& ray,
+    const ShearedRay& sr,
+    const size_t& i,
+    Vec4f& u,
+    Vec4f& v
+) const {
+    // watertight intersection test by Woop et al.
+    // that never misses hits on shared edges
+
+    // corners relative to the ray origin
+    std::array<Vec4f, 3> A; sub(A, As[i], ray.origin);
+    std::array<Vec4f, 3> B; sub(B, Bs[i], ray.origin);
+    std::array<Vec4f, 3> C; sub(C, Cs[i], ray.origin);
+    // shear and scale the corners
+    // into the space of the ray
+    Vec4f Ax = A[sr.kx] - sr.Sx * A[sr.kz];
+    Vec4f Ay = A[sr.ky] - sr.Sy * A[sr.kz];
+    Vec4f Bx = B[sr.kx] - sr.Sx * B[sr.kz];
+    Vec4f By = B[sr.ky] - sr.Sy * B[sr.kz];
+    Vec4f Cx = C[sr.kx] - sr.Sx * C[sr.kz];
+    Vec4f Cy = C[sr.ky] - sr.Sy * C[sr.kz];
+    // scaled barycentric coordinates
+    // given by the edge functions
+    Vec4f U = edge_function(Cx, Cy, Bx, By);
+    Vec4f V = edge_function(Ax, Ay, Cx, Cy);
+    Vec4f W = edge_function(Bx, By, Ax, Ay);
+    // the ray misses if the edge functions have
+    // different signs or if all of them are zero
+    Vec4f neg = U.lt(Vec4f::zeros) | V.lt(Vec4f::zeros) | W.lt(Vec4f::zeros);
+    Vec4f pos = Vec4f::zeros.lt(U) | Vec4f::zeros.lt(V) | Vec4f::zeros.lt(W);
+    Vec4f det = U + V + W;
+    Vec4f mask1 = _mm_andnot_ps(neg & pos, pos | neg);
+    // compute the scaled hit distance
+    Vec4f T = U * (sr.Sz * A[sr.kz]) + V * (sr.Sz * B[sr.kz]) + W * (sr.Sz * C[sr.kz]);
+    // normalize the distance and coordinates
+    Vec4f inv_det = Vec4f::ones / det;
+    Vec4f ts = T * inv_det;
+    u = V * inv_det;
+    v = W * inv_det;
+    // make sure the hit is in front of the ray
+    Vec4f mask2 = (Vec4f::eps < ts);
+    // mark invalids
+    return Vec4f(-1.0f).take(ts, mask1 & mask2);
+}
+
+inline Vec4f TriangleCollection::cast_ray_packet_plane(
+    const Ray4& ray,
+    const size_t& i,
+    Vec4f& u,
+    Vec4f& v
+) const {
+    // intersection test by Havel and Herout using the
+    // plane of the triangle and the planes through its
+    // edges scaled by the inverse area of the triangle
+    const std::array<Vec4f, 12>& P = planes[i];
+    // distance to the plane scaled by the
+    // cosine between ray and normal
+    Vec4f det = ray.direction[0].fmadd(P[0], ray.direction[1].fmadd(P[1], ray.direction[2] * P[2]));
+    Vec4f tt = P[3] - ray.origin[0].fmadd(P[0], ray.origin[1].fmadd(P[1], ray.origin[2] * P[2]));
+    // scaled point of intersection
+    Vec4f px = det.fmadd(ray.origin[0], tt * ray.direction[0]);
+    Vec4f py = det.fmadd(ray.origin[1], tt * ray.direction[1]);
+    Vec4f pz = det.fmadd(ray.origin[2], tt * ray.direction[2]);
+    // scaled barycentric coordinates
+    Vec4f us = px.fmadd(P[4], py.fmadd(P[5], pz.fmadd(P[6], det * P[7])));
+    Vec4f vs = px.fmadd(P[8], py.fmadd(P[9], pz.fmadd(P[10], det * P[11])));
+    Vec4f ws = det - us - vs;
+    // all scaled coordinates need to have the same
+    // sign, i.e. their sign bits must not differ
+    Vec4f mask1 = _mm_or_ps(_mm_xor_ps(us, vs), _mm_xor_ps(us, ws));
+    // normalize the distance and coordinates
+    Vec4f inv_det = Vec4f::ones / det;
+    Vec4f ts = tt * inv_det;
+    u = us * inv_det;
+    v = vs * inv_det;
+    // make sure the hit is in front of the ray
+    // and the ray is not parallel to the plane
+    Vec4f mask2 = (Vec4f::eps < ts) & _mm_cmpneq_ps(det, Vec4f::zeros);
+    // mark invalids, note that the first mask
+    // has its sign bit set for misses
+    ts = ts.take(Vec4f(-1.0f), mask1);
+    return Vec4f(-1.0f).take(ts, mask2);
+}
+
+inline bool TriangleCollection::cast(
+    const Ray4& ray,
+    const size_t& begin,
+    const size_t& end,
+    Hit& hit
+) const {
+    // nothing to do for empty ranges
+    if (begin == end) { return false; }
+    // the kernel is the same for all ranges
+    // and thus the branch is easy to predict
+    switch (_kernel) {
+        case TriangleKernel::MollerTrumbore:
+            return cast_packets(*this, ray, begin, end, hit);
+        case TriangleKernel::Watertight: {
+            ShearedRay sheared = shear_ray(ray);
+            return cast_packets<type>(
+                [&](const size_t& k, Vec4f& us, Vec4f& vs) {
+                    return cast_ray_packet_watertight(ray, sheared, k, us, vs);
+                },
+                begin, end, hit
+            );
+        }
+        case TriangleKernel::Plane:
+            return cast_packets<type>(
+                [&](const size_t& k, Vec4f& us, Vec4f& vs) {
+                    return cast_ray_packet_plane(ray, k, us, vs);
+                },
+                begin, end, hit
+            );
+    }
+    return false;
+}
+
+inline void TriangleCollection::prefetch(const size_t& i) const {
+    switch (_kernel) {
+        case TriangleKernel::MollerTrumbore:
+            As.prefetch(i); Us.prefetch(i); Vs.prefetch(i);
+            break;
+        case TriangleKernel::Watertight:
+            As.prefetch(i); Bs.prefetch(i); Cs.prefetch(i);
+            break;
+        case TriangleKernel::Plane:
+            planes.prefetch(i);
+            break;
+    }
+}
+
 
 /*
  *  Sphere
@@ -195,41 +553,94 @@ public:
     friend SphereCollection;
 };
 
-// combine a number of spheres into a single
-// primitive
-class SphereCollection : public PrimitiveCollection {
+// flat array of sphere packets, the spheres
+// of different leafs never share a packet
+class SphereCollection {
 private:
     // data of all the sphere packets
     // separated into single components
-    std::vector<std::array<Vec4f, 3>> centers;
-    std::vector<Vec4f> radii;
-    std::vector<const mtl::Material*> mtls;
-    // size of the collection
+    Buffer<std::array<Vec4f, 3>> centers;
+    Buffer<Vec4f> radii;
+    // material ids of all spheres including the
+    // padding lanes and the material table
+    Buffer<uint32_t> mtl_ids;
+    std::vector<const mtl::Material*> materials;
+    // number of used lanes
     size_t n_spheres = 0;
-    // function to cast a ray to a single
-    // packer of spheres
-    Vec4f cast_ray_packet(
-        const Ray4& ray,
-        const size_t& i
-    ) const;
-    // get the normal of a primitive at
-    // the given point on its surface
-    Vec3f get_normal(
-        const size_t& i,    // index of the primitive
-        const Vec3f& p      // point on surface
-    ) const;
-    // get the material of a primitive
-    const mtl::Material* get_material(const size_t& i) const;
+    // allow the scene to store the
+    // packets in a snapshot
+    friend Scene;
 public:
+    // the type of primitive stored
+    static constexpr PrimitiveType type = PrimitiveType::Sphere;
     // constructors
     SphereCollection(void) = default;
     // add sphere to collection
     void push_back(const Sphere& S);
+    // pad the last packet such that the
+    // next sphere starts a new packet
+    void close_packet(void);
+    // cast a ray against a single packet
+    // of spheres and return the distances
+    inline Vec4f cast_ray_packet(
+        const Ray4& ray,
+        const size_t& i,
+        Vec4f& u,
+        Vec4f& v
+    ) const;
+    // hint the caches to load the i-th packet
+    inline void prefetch(const size_t& i) const;
+    // reconstruct the full hit record
+    // of the given hit
+    void surface(
+        const Hit& hit,
+        const Vec3f& origin,
+        const Vec3f& direction,
+        HitRecord& record
+    ) const;
+    // the material of the primitive of the given hit
+    // without reconstructing the full hit record
+    const mtl::Material* material(const Hit& hit) const;
     // total number of primitive packets
     // currently stored in the collection
     size_t n_packets(void) const;
     // total number of primtives stored
+    // including the padding lanes
     size_t n_primitives(void) const; 
 };
 
+inline Vec4f SphereCollection::cast_ray_packet(
+    const Ray4& ray,
+    const size_t& i,
+    Vec4f& u,
+    Vec4f& v
+) const {
+    // gather all properties of the primitives
+    // in the packet indicated by the given index
+    const std::array<Vec4f, 3>& C = centers[i];
+    const Vec4f& R = radii[i];
+
+    // compute the distriminant
+    std::array<Vec4f, 3> oc; sub(oc, ray.origin, C);
+    Vec4f a = dot(ray.direction, ray.direction);
+    Vec4f b = dot(oc, ray.direction);
+    Vec4f c = dot(oc, oc) - (R * R);
+    Vec4f d = (b * b) - (a * c);
+    // compute distances
+    Vec4f d_sqrt = d.sqrt();
+    Vec4f ts = -1 * d_sqrt - b;
+    ts = ts.take(d_sqrt - b, ts < Vec4f::zeros) / a;
+    // mark invalids
+    ts = ts.take(-1 * Vec4f::ones, d < Vec4f::zeros);
+    // spheres are not parameterized
+    u = v = Vec4f::zeros;
+    // return distances
+    return ts;
+}
+
+inline void SphereCollection::prefetch(const size_t& i) const {
+    centers.prefetch(i);
+    radii.prefetch(i);
+}
+
 #endif // H_PRIMITIVE
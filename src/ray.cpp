@@ -0,0 +1,73 @@
+#include "./ray.hpp"
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+/*
+ *  Ray Stream
+ */
+
+RayStream::~RayStream(void)
+{
+    // free the aligned memory
+    if (memory) { _mm_free(memory); }
+}
+
+void RayStream::reserve(const size_t& n)
+{
+    // nothing to do if there is
+    // enough memory already
+    if (n <= _capacity) { return; }
+    // round the capacity up to a multiple of eight
+    // such that each array stays 32-byte aligned
+    size_t capacity = (n + 7) & ~(size_t)7;
+    float* new_memory = (float*)_mm_malloc(8 * capacity * sizeof(float), 32);
+    // copy the current rays component by
+    // component to the new memory
+    if (memory) {
+        for (size_t c = 0; c < 8; c++) {
+            std::memcpy(new_memory + c * capacity, memory + c * _capacity, _size * sizeof(float));
+        }
+        _mm_free(memory);
+    }
+    // update the component arrays
+    memory = new_memory;
+    _capacity = capacity;
+    ox = memory + 0 * capacity; oy = memory + 1 * capacity; oz = memory + 2 * capacity;
+    dx = memory + 3 * capacity; dy = memory + 4 * capacity; dz = memory + 5 * capacity;
+    tmax = memory + 6 * capacity;
+    path = (uint32_t*)(memory + 7 * capacity);
+}
+
+void RayStream::resize(const size_t& n)
+{
+    // make sure there is enough memory
+    // for the given number of rays
+    if (n > _capacity) { reserve(std::max(n, 2 * _capacity)); }
+    _size = n;
+}
+
+void RayStream::push_back(
+    const Ray& ray,
+    const uint32_t& path_id
+) {
+    // grow the memory if needed
+    if (_size == _capacity) { reserve(std::max<size_t>(8, 2 * _capacity)); }
+    // write all components of the ray
+    size_t i = _size++;
+    ox[i] = ray.origin[0]; oy[i] = ray.origin[1]; oz[i] = ray.origin[2];
+    dx[i] = ray.direction[0]; dy[i] = ray.direction[1]; dz[i] = ray.direction[2];
+    tmax[i] = std::numeric_limits<float>::infinity();
+    path[i] = path_id;
+}
+
+void RayStream::swap(RayStream& other)
+{
+    std::swap(_size, other._size);
+    std::swap(_capacity, other._capacity);
+    std::swap(memory, other.memory);
+    std::swap(ox, other.ox); std::swap(oy, other.oy); std::swap(oz, other.oz);
+    std::swap(dx, other.dx); std::swap(dy, other.dy); std::swap(dz, other.dz);
+    std::swap(tmax, other.tmax);
+    std::swap(path, other.path);
+}
@@ -4,8 +4,26 @@
 // includes
 #include <array>
 #include <vector>
+#include <limits>
+#include <cstdint>
 #include "./vec.hpp"
-#include "./primitive.hpp"
+
+// types of primitives a ray can hit
+enum class PrimitiveType : uint32_t {
+    None,
+    Triangle,
+    Sphere
+};
+
+// compact record of the closest intersection
+// of a ray found so far, the full hit record is
+// only reconstructed from it once at shading
+typedef struct Hit {
+    float t = std::numeric_limits<float>::infinity(); // distance to intersection point
+    float u = 0.0f, v = 0.0f;   // barycentric coordinates
+    uint32_t prim_id = 0;       // index of the primitive in its collection
+    PrimitiveType type = PrimitiveType::None; // type of the primitive
+} Hit;
 
 // contribution information needed to
 // interatively update the color of a
@@ -14,19 +32,19 @@ typedef struct RayContrib {
     Vec3f color = Vec3f::zeros;     // color after i (scatter-) rays
     Vec3f albedo = Vec3f::ones;     // color influence of the current ray
     bool is_final = false;          // is the color final
-    HitRecord hit_record;           // hit-record of the currentl ray
+    size_t pixel = 0;               // pixel index inside the render tile
+    uint32_t sample = 0;            // index of the sample inside the pixel
+    size_t depth = 0;               // number of bounces of the path
+    float cone_width = 0.0f;        // width of the ray cone at the ray origin
+    float cone_spread = 0.0f;       // growth of the width per unit distance
+    Hit hit;                        // closest hit of the current ray
 } RayContrib;
 
 // ray structure combining positional
 // and directional information
 typedef struct Ray {
-    // positional and directional
-    // information of the ray
     Vec3f origin;
     Vec3f direction;
-    // reference to the contribution
-    // info of the ray
-    RayContrib* contrib;
 } Ray;
 
 // a packet of four rays usually
@@ -36,7 +54,68 @@ typedef struct Ray4 {
     std::array<Vec4f, 3> direction;
 } Ray4;
 
-// shortcur for a vector of rays
-class RayQueue : public std::vector<Ray> {};
+// stream of rays stored as a structure of arrays,
+// each component lives in its own 32-byte aligned
+// array such that simd kernels can load multiple
+// consecutive rays with a single load per component
+class RayStream {
+private:
+    // number of rays and allocated slots
+    size_t _size = 0;
+    size_t _capacity = 0;
+    // single allocation holding all arrays
+    float* memory = nullptr;
+public:
+    // the component arrays
+    float *ox = nullptr, *oy = nullptr, *oz = nullptr;
+    float *dx = nullptr, *dy = nullptr, *dz = nullptr;
+    // maximum distance of a valid hit
+    float *tmax = nullptr;
+    // index of the path the ray belongs
+    // to in the contribution buffer
+    uint32_t *path = nullptr;
+    // constructors and destructor
+    RayStream(void) = default;
+    RayStream(const RayStream& other) = delete;
+    RayStream& operator=(const RayStream& other) = delete;
+    ~RayStream(void);
+    // size and memory management
+    size_t size(void) const { return _size; }
+    bool empty(void) const { return _size == 0; }
+    void reserve(const size_t& n);
+    void resize(const size_t& n);
+    void clear(void) { _size = 0; }
+    // add a ray of the given path
+    void push_back(
+        const Ray& ray,
+        const uint32_t& path_id
+    );
+    // copy the j-th ray of another
+    // stream to the i-th position
+    inline void set(
+        const size_t& i,
+        const RayStream& other,
+        const size_t& j
+    ) {
+        ox[i] = other.ox[j]; oy[i] = other.oy[j]; oz[i] = other.oz[j];
+        dx[i] = other.dx[j]; dy[i] = other.dy[j]; dz[i] = other.dz[j];
+        tmax[i] = other.tmax[j];
+        path[i] = other.path[j];
+    }
+    // gather the i-th ray
+    inline Ray get(const size_t& i) const {
+        return { Vec3f(ox[i], oy[i], oz[i]), Vec3f(dx[i], dy[i], dz[i]) };
+    }
+    // build a packet holding four
+    // copies of the i-th ray
+    inline Ray4 broadcast(const size_t& i) const {
+        return {
+            { Vec4f(ox[i]), Vec4f(oy[i]), Vec4f(oz[i]) },
+            { Vec4f(dx[i]), Vec4f(dy[i]), Vec4f(dz[i]) }
+        };
+    }
+    // exchange the memory of two streams
+    void swap(RayStream& other);
+};
 
 #endif // H_RAY
@@ -1,29 +1,189 @@
 #include "./renderer.hpp"
 #include "./framebuffer.hpp"
-#include <thread>
-#include <threadpool.h>
-#include <rng.hpp>
+#include "./context.hpp"
+#include <chrono>
 #include <math.h>
+#include <algorithm>
+
+// helper function spreading the lower 10 bits of
+// the given value such that there are two zero
+// bits between each pair of consecutive bits
+inline uint32_t spread_bits(uint32_t v) {
+    v = (v | (v << 16)) & 0x030000ffu;
+    v = (v | (v <<  8)) & 0x0300f00fu;
+    v = (v | (v <<  4)) & 0x030c30c3u;
+    v = (v | (v <<  2)) & 0x09249249u;
+    return v;
+}
+
+// helper function computing the reordering keys of
+// four consecutive rays of a stream, i.e. the octant
+// of their direction followed by the morton code of
+// their quantized origin
+inline void ray_keys4(
+    const RayStream& rays,
+    const size_t& i,
+    const std::array<Vec4f, 3>& low,
+    const std::array<Vec4f, 3>& scale,
+    uint32_t* keys
+) {
+    // quantize the origins to 9 bits per axis, note
+    // that the arrays of the stream are aligned
+    Vec4f max_q(511.0f);
+    Vec4f qx = ((Vec4f(_mm_load_ps(rays.ox + i)) - low[0]) * scale[0]).max(Vec4f::zeros).min(max_q);
+    Vec4f qy = ((Vec4f(_mm_load_ps(rays.oy + i)) - low[1]) * scale[1]).max(Vec4f::zeros).min(max_q);
+    Vec4f qz = ((Vec4f(_mm_load_ps(rays.oz + i)) - low[2]) * scale[2]).max(Vec4f::zeros).min(max_q);
+    // the sign bits of the directions
+    // give their octants
+    unsigned int sx = _mm_movemask_ps(_mm_load_ps(rays.dx + i));
+    unsigned int sy = _mm_movemask_ps(_mm_load_ps(rays.dy + i));
+    unsigned int sz = _mm_movemask_ps(_mm_load_ps(rays.dz + i));
+    for (size_t j = 0; j < 4; j++) {
+        uint32_t code = (spread_bits((uint32_t)qx[j]) << 2) 
+                      | (spread_bits((uint32_t)qy[j]) << 1) 
+                      | spread_bits((uint32_t)qz[j]);
+        uint32_t octant = ((sx >> j) & 1u) | (((sy >> j) & 1u) << 1) | (((sz >> j) & 1u) << 2);
+        keys[j] = (octant << 27) | code;
+    }
+}
+
+// the sampler used unless another one is set
+static const SobolSampler default_sampler;
+// the dimensions of the samples, i.e. the position in
+// the pixel followed by a pair for the direction and
+// one dimension for the lobe of the material per bounce
+const uint32_t dim_pixel = 0;
+const uint32_t dim_bounce = 2;
+const uint32_t dims_per_bounce = 4;
+// batches of paths per worker in the pipelined mode,
+// such that the workers find batches in all stages
+const size_t pipeline_batches = 3;
+
+// helper function writing the average of the
+// given sum of colors to a pixel of the image
+inline void write_pixel(
+    FrameBuffer& fb,
+    const size_t& i,
+    const size_t& j,
+    const Vec3f& sum,
+    const size_t& n
+) {
+    // average the color over all rays
+    // that go through the pixel
+    Vec3f c = sum / (float)n;
+    // apply postprocessing including
+    // a simple approxiamtion of
+    // gamma correction filter
+    c = c.min(Vec3f::ones).max(Vec3f::zeros);
+    c = c.sqrt() * 255.0f;
+    // write the color to the framebuffer
+    fb.set_pixel(i, j, c[0], c[1], c[2]);
+}
 
 /*
  *  Render Args
  */
 
+RenderArgs::RenderArgs(void) :
+    contrib_buffer(nullptr),
+    buffer_length(0)
+{
+}
+
 RenderArgs::RenderArgs(
     const size_t& n_rays,
     const BVH& bvh
+) :
+    RenderArgs()
+{
+    resize(n_rays, bvh);
+}
+
+RenderArgs::~RenderArgs(void) {
+    // free memory
+    delete[] contrib_buffer;
+}
+
+void RenderArgs::resize(
+    const size_t& n_rays,
+    const BVH& bvh
 ) {
+    // the leaf counts and stamps of a larger hierarchy, note
+    // that all counts and stamps are zero between two sorts
+    if (leaf_sort.offsets.size() < bvh.num_leafs()) {
+        leaf_sort.offsets.resize(bvh.num_leafs(), 0);
+        leaf_sort.last_rays.resize(bvh.num_leafs(), 0);
+    }
+    if (n_rays == buffer_length) { return; }
     // allocate memory for contributions of each ray
+    delete[] contrib_buffer;
     contrib_buffer = new RayContrib[n_rays];
     buffer_length = n_rays;
     // initialize vectors
     rays.reserve(n_rays);
-    sorted_rays = std::vector<RayQueue>(bvh.num_leafs());
+    next_rays.reserve(n_rays);
+    sorted_rays.reserve(n_rays);
+    shade_keys.reserve(n_rays);
+    shade_order.reserve(n_rays);
+    shade_slots.reserve(n_rays);
+    shade_records.reserve(n_rays);
+    shade_attenuations.reserve(n_rays);
+    shade_emittances.reserve(n_rays);
 }
 
-RenderArgs::~RenderArgs(void) {
-    // free memory
-    delete[] contrib_buffer;
+
+/*
+ *  Render Job
+ */
+
+RenderJob::RenderJob(FrameBuffer& fb) :
+    fb(fb),
+    n_rendered(0),
+    n_finished(0),
+    _cancelled(false),
+    next_tile(0)
+{
+}
+
+RenderJob::~RenderJob(void) {
+    // skip the remaining tiles and wait
+    // for the ones that are running
+    cancel();
+    wait();
+}
+
+float RenderJob::progress(void) const {
+    if (tiles.empty()) { return 1.0f; }
+    return (float)n_rendered / (float)tiles.size();
+}
+
+bool RenderJob::done(void) const { return n_finished == tiles.size(); }
+bool RenderJob::cancelled(void) const { return _cancelled; }
+void RenderJob::cancel(void) { _cancelled = true; }
+
+bool RenderJob::wait(void) {
+    // wait for the last tile to finish
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this]{ return n_finished == tiles.size(); });
+    return n_rendered == tiles.size();
+}
+
+size_t RenderJob::partial(FrameBuffer& out) const {
+    // copy the pixels of all written tiles
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t n = 0;
+    for (size_t t = 0; t < tiles.size(); t++) {
+        if (!tile_done[t]) { continue; }
+        const RenderTile& tile = tiles[t];
+        for (size_t i = tile.i; i < tile.i + tile.height; i++) {
+            for (size_t j = tile.j; j < tile.j + tile.width; j++) {
+                const unsigned char* c = fb.pixel(i, j);
+                out.set_pixel(i, j, c[0], c[1], c[2]);
+            }
+        }
+        n++;
+    }
+    return n;
 }
 
 
@@ -40,205 +200,767 @@ Renderer::Renderer(
     scene(scene),
     cam(cam),
     bvh(scene.bvh()),
-    primitives(scene.primitives()),
     rpp(rpp),
-    max_rdepth(max_rdepth)
+    max_rdepth(max_rdepth),
+    _sampler(&default_sampler)
 {
 }
 
-void Renderer::build_pixel_rays(
+// getters
+const size_t& Renderer::tile_size(void) const { return _tile_size; }
+const size_t& Renderer::stream_size(void) const { return _stream_size; }
+const bool& Renderer::regeneration(void) const { return _regeneration; }
+const bool& Renderer::reordering(void) const { return _reordering; }
+const bool& Renderer::pipelining(void) const { return _pipelining; }
+const bool& Renderer::prefetching(void) const { return _prefetching; }
+const Sampler& Renderer::sampler(void) const { return *_sampler; }
+RenderContext& Renderer::context(void) const { return (_context != nullptr)? *_context : RenderContext::global(); }
+// setters
+void Renderer::tile_size(const size_t& new_tile_size) { _tile_size = new_tile_size; }
+void Renderer::stream_size(const size_t& new_stream_size) { _stream_size = new_stream_size; }
+void Renderer::regeneration(const bool& new_regeneration) { _regeneration = new_regeneration; }
+void Renderer::reordering(const bool& new_reordering) { _reordering = new_reordering; }
+void Renderer::pipelining(const bool& new_pipelining) { _pipelining = new_pipelining; }
+void Renderer::prefetching(const bool& new_prefetching) { _prefetching = new_prefetching; }
+void Renderer::sampler(const Sampler& new_sampler) { _sampler = &new_sampler; }
+void Renderer::context(RenderContext& new_context) { _context = &new_context; }
+void Renderer::tile_cache(txr::TileCache* cache) { _tile_cache = cache; }
+
+const Scene& Renderer::local_scene(const size_t& node) const {
+    RenderContext& ctx = context();
+    if (!ctx.replication()) { return scene; }
+    std::lock_guard<std::mutex> lock(replica_mutex);
+    if (replicas.size() <= node) {
+        replicas.resize(node + 1);
+        has_replica.resize(node + 1, false);
+    }
+    // the first worker of the node that needs the
+    // replica builds it, which places its pages on
+    // the node of the worker, the scene is shared
+    // if the replica does not fit into the memory
+    if (!has_replica[node]) {
+        has_replica[node] = true;
+        if (2 * scene.n_bytes() <= ctx.topology().free_memory(node)) {
+            replicas[node].reset(new Scene());
+            replicas[node]->replicate(scene);
+        }
+    }
+    return replicas[node]? *replicas[node] : scene;
+}
+
+RenderStats Renderer::stats(void) const {
+    // return a copy of the counters
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return _stats;
+}
+
+txr::TileCacheStats Renderer::begin_stats(void) const {
+    // reset the counters of the previous call
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        _stats = RenderStats();
+    }
+    // the counters of the tile cache count over
+    // all calls, remember them before rendering
+    txr::TileCacheStats before;
+    if (_tile_cache != nullptr) { before = _tile_cache->stats(); }
+    return before;
+}
+
+void Renderer::end_stats(const txr::TileCacheStats& before) const {
+    // the lookups of the tile cache during the call
+    if (_tile_cache != nullptr) {
+        txr::TileCacheStats after = _tile_cache->stats();
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        _stats.tile_cache.n_hits = after.n_hits - before.n_hits;
+        _stats.tile_cache.n_misses = after.n_misses - before.n_misses;
+        _stats.tile_cache.n_bytes_read = after.n_bytes_read - before.n_bytes_read;
+    }
+}
+
+bool Renderer::build_camera_ray(
     RenderArgs& args,
-    const size_t& i,
-    const size_t& j,
-    const size_t& width,
-    const size_t& height,
-    const float& vpw,
-    const float& vph
-) const {
-    // build all rays that go through
-    // the current pixel (i, j)
-    for (size_t k = 0; k < rpp; k++) {
-        // fill a 2x2 sub-pixel grid
-        // and add a noise term
-        size_t pi = k / 2 % 2, pj = k % 2;                
-        float su = (float)(i * 2 + pi + rng::randf()) / (2 * height) - 0.5f;
-        float sv = (float)(j * 2 + pj + rng::randf()) / (2 * width) - 0.5f;
-        // build the ray with origin on the viewport
-        // and direction through the sub-pixel
-        Ray r = cam.build_ray_from_uv(su * vph, sv * vpw);
-        // set the pointer to the ray contribution
-        // of the primary ray and add it to the queue
-        r.contrib = args.contrib_buffer + k;
-        args.rays.push_back(r);
+    const size_t& slot,
+    RayStream& stream
+) const {
+    // make sure the sample budget
+    // of the tile is not used up
+    if (args.next_sample >= args.n_samples) { return false; }
+    // the samples are ordered by pixel such that
+    // consecutive samples go through the same pixel
+    const RenderTile& tile = args.tile;
+    size_t s = args.next_sample++;
+    size_t p = s / args.pixel_samples;
+    size_t k = args.first_sample + s % args.pixel_samples;
+    size_t i = tile.i + p / tile.width;
+    size_t j = tile.j + p % tile.width;
+    // the sampler places the sample in the pixel
+    float su = (i + _sampler->get(j, i, k, dim_pixel)) / tile.img_height - 0.5f;
+    float sv = (j + _sampler->get(j, i, k, dim_pixel + 1)) / tile.img_width - 0.5f;
+    // build the ray with origin on the viewport
+    // and direction through the sub-pixel
+    Ray r = cam.build_ray_from_uv(su * tile.vph, sv * tile.vpw);
+    // reset the contribution of the slot and
+    // assign the pixel the ray goes through
+    RayContrib* contrib = args.contrib_buffer + slot;
+    *contrib = RayContrib();
+    contrib->pixel = p;
+    contrib->sample = k;
+    // the ray cone starts at the camera and spreads
+    // by the angle covered by a single pixel
+    contrib->cone_spread = tile.vpw / tile.img_width;
+    // add the primary ray of the
+    // path to the stream
+    stream.push_back(r, slot);
+    return true;
+}
+
+Vec3f Renderer::scatter_sample(
+    const RenderArgs& args,
+    const RayContrib& contrib
+) const {
+    // the pixel of the path in the image and the
+    // first dimension of the current bounce
+    const RenderTile& tile = args.tile;
+    uint32_t i = tile.i + contrib.pixel / tile.width;
+    uint32_t j = tile.j + contrib.pixel % tile.width;
+    uint32_t dim = dim_bounce + contrib.depth * dims_per_bounce;
+    // the lobe is picked by a single dimension
+    // and the direction by a pair of dimensions
+    float lobe = _sampler->get(j, i, contrib.sample, dim + 2);
+    float u1 = _sampler->get(j, i, contrib.sample, dim);
+    float u2 = _sampler->get(j, i, contrib.sample, dim + 1);
+    return Vec3f(lobe, u1, u2);
+}
+
+bool Renderer::finish_path(
+    RenderArgs& args,
+    const size_t& slot
+) const {
+    // add the color of the path to
+    // the pixel it was started from
+    RayContrib* contrib = args.contrib_buffer + slot;
+    args.pixel_colors[contrib->pixel] = args.pixel_colors[contrib->pixel] + contrib->color;
+    contrib->is_final = true;
+    // immediately start a new path in the
+    // slot to keep the ray stream full
+    return _regeneration && build_camera_ray(args, slot, args.next_rays);
+}
+
+void Renderer::build_pixel_rays(
+    RenderArgs& args
+) const {
+    // build camera rays into all slots of the
+    // contribution buffer until either the buffer
+    // is full or the sample budget is used up
+    for (size_t i = 0; i < args.buffer_length; i++) {
+        if (!build_camera_ray(args, i, args.rays)) { break; }
     }
 }
 
+void Renderer::reorder_rays(
+    RenderArgs& args
+) const {
+    // offset and scale mapping the scene
+    // bounds to the quantization grid
+    const AABB& bounds = args.scene->bvh().bounds();
+    Vec3f extent = (bounds.upper() - bounds.lower()).max(Vec3f::eps);
+    Vec3f scale = Vec3f(511.0f) / extent;
+    std::array<Vec4f, 3> low4 = { Vec4f(bounds.lower()[0]), Vec4f(bounds.lower()[1]), Vec4f(bounds.lower()[2]) };
+    std::array<Vec4f, 3> scale4 = { Vec4f(scale[0]), Vec4f(scale[1]), Vec4f(scale[2]) };
+    // compute the keys of four rays at a time, note
+    // that the stream is padded to a multiple of eight
+    size_t n = args.rays.size();
+    uint32_t keys[4];
+    for (size_t r = 0; r < n; r += 4) {
+        ray_keys4(args.rays, r, low4, scale4, keys);
+        for (size_t j = 0; (j < 4) && (r + j < n); j++) {
+            args.ray_keys.push_back({ keys[j], (uint32_t)(r + j) });
+        }
+    }
+    // sort the keys by a least significant digit radix
+    // sort using 10-bit digits over the 30-bit keys
+    args.ray_keys_tmp.resize(args.ray_keys.size());
+    for (uint32_t shift = 0; shift < 30; shift += 10) {
+        // count the digits and turn
+        // the counts into offsets
+        size_t offsets[1024] = { 0 };
+        for (const std::pair<uint32_t, uint32_t>& p : args.ray_keys) {
+            offsets[(p.first >> shift) & 1023u]++;
+        }
+        size_t offset = 0;
+        for (size_t d = 0; d < 1024; d++) {
+            size_t count = offsets[d];
+            offsets[d] = offset;
+            offset += count;
+        }
+        // scatter the keys by their digit
+        for (const std::pair<uint32_t, uint32_t>& p : args.ray_keys) {
+            args.ray_keys_tmp[offsets[(p.first >> shift) & 1023u]++] = p;
+        }
+        std::swap(args.ray_keys, args.ray_keys_tmp);
+    }
+    // permute the rays using the next rays
+    // stream which is free at this point
+    args.next_rays.resize(n);
+    for (size_t r = 0; r < n; r++) {
+        args.next_rays.set(r, args.rays, args.ray_keys[r].second);
+    }
+    args.rays.swap(args.next_rays);
+    args.next_rays.clear();
+    args.ray_keys.clear();
+}
+
 void Renderer::sort_rays_into_buckets(
     RenderArgs& args
 ) const {
     // let the bounding volume hierarchy sort
-    // the ray queue into the leaf buckets
-    bvh.sort_rays_by_leafs(args.rays, args.sorted_rays);
-    // clear the ray queue since all rays
-    // now are sorted into buckets
-    args.rays.clear();
+    // the ray queue into the flat leaf array
+    args.scene->bvh().sort_rays_by_leafs(args.rays, args.leaf_sort, args.sorted_rays, _prefetching);
+    args.stats.n_rays += args.rays.size();
     // build the render buckets combining
-    // a queue of rays with the primitive
-    // to cast the rays to
-    for (size_t i = 0; i < args.sorted_rays.size(); ++i) {
-        RayQueue& queue = args.sorted_rays[i];
-        // add a render bucket from the current
-        // sorted queue if it is not empty
-        if (!queue.empty()) {
-            RenderBucket bucket = { queue, primitives[i] };
-            args.render_buckets.push_back(bucket);
-        }
+    // a range of sorted rays with the
+    // leaf to cast the rays to
+    for (const LeafRange& range : args.leaf_sort.ranges) {
+        RenderBucket bucket = { range.begin, range.end, range.leaf_id };
+        args.render_buckets.push_back(bucket);
     }
+    args.leaf_sort.ranges.clear();
 }
 
 void Renderer::flush_buckets(
     RenderArgs& args
 ) const {
-    // create a temporary hitrecord to compare
-    // to the current best
-    HitRecord tmp;
-    // process all render buckets
-    for (RenderBucket& bucket : args.render_buckets) {
-        // cast each ray against the associated primitive
-        // and update the hitrecord to discribe the closest hit
-        for (Ray& ray : bucket.rays) {
-            // get a reference to the current hitrecord
-            HitRecord& record = ray.contrib->hit_record;            
-            // cast and update the hitrecord
-            if (bucket.prim->cast(ray, tmp) && (
-                    (tmp.is_valid && !record.is_valid) ||
-                    (tmp.is_valid && record.is_valid && (record.t > tmp.t))
-            )) { record = tmp; }
-            // reset the temporary hitrecord
-            tmp.is_valid = false;
-        }
-        // clear the rays of the current bucket
-        bucket.rays.clear();
-    }
-    // clear render buckets
+    // process all render buckets, the leafs of the buckets
+    // are spread over the scene such that the hardware
+    // cannot predict them, instead the packet ranges of a
+    // leaf are prefetched two buckets ahead and its first
+    // packets one bucket ahead
+    size_t n = args.render_buckets.size();
+    for (size_t b = 0; b < n; b++) {
+        if (_prefetching && (b + 2 < n)) { args.scene->prefetch_leaf(args.render_buckets[b + 2].leaf_id); }
+        if (_prefetching && (b + 1 < n)) { args.scene->prefetch_packets(args.render_buckets[b + 1].leaf_id); }
+        const RenderBucket& bucket = args.render_buckets[b];
+        // cast each ray against the primitives of the
+        // associated leaf which updates the hit in
+        // place whenever it finds a closer intersection
+        for (size_t k = bucket.begin; k < bucket.end; k++) {
+            RayContrib& contrib = args.contrib_buffer[args.sorted_rays.path[k]];
+            args.scene->cast(args.sorted_rays.broadcast(k), bucket.leaf_id, contrib.hit);
+        }
+    }
+    // clear the sorted rays and render buckets
+    args.sorted_rays.clear();
     args.render_buckets.clear();
 }
 
+void Renderer::shade_hits(
+    RenderArgs& args
+) const {
+    size_t n = args.rays.size();
+    args.shade_materials.clear();
+    args.shade_keys.clear();
+    // look up the index of the material of each ray
+    // that hit anything, there are only a few materials
+    // and consecutive hits often share the same one
+    uint32_t last = 0;
+    for (size_t k = 0; k < n; k++) {
+        const RayContrib* contrib = args.contrib_buffer + args.rays.path[k];
+        if (contrib->hit.type == PrimitiveType::None) { continue; }
+        const mtl::Material* mat = args.scene->material(contrib->hit);
+        if ((last >= args.shade_materials.size()) || (args.shade_materials[last] != mat)) {
+            auto it = std::find(args.shade_materials.begin(), args.shade_materials.end(), mat);
+            last = it - args.shade_materials.begin();
+            if (it == args.shade_materials.end()) { args.shade_materials.push_back(mat); }
+        }
+        args.shade_keys.push_back({ last, (uint32_t)k });
+    }
+    // group the hits by their materials
+    // by a counting sort over the indices
+    size_t n_groups = args.shade_materials.size();
+    args.shade_offsets.assign(n_groups + 1, 0);
+    for (const std::pair<uint32_t, uint32_t>& key : args.shade_keys) { args.shade_offsets[key.first + 1]++; }
+    for (size_t g = 0; g < n_groups; g++) { args.shade_offsets[g + 1] += args.shade_offsets[g]; }
+    size_t m = args.shade_keys.size();
+    args.shade_order.resize(m);
+    args.shade_slots.resize(n);
+    for (const std::pair<uint32_t, uint32_t>& key : args.shade_keys) {
+        size_t i = args.shade_offsets[key.first]++;
+        args.shade_order[i] = key.second;
+        args.shade_slots[key.second] = i;
+    }
+    // reconstruct the full hit records in the grouped order
+    args.shade_records.resize(m);
+    args.shade_attenuations.resize(m);
+    args.shade_emittances.resize(m);
+    for (size_t i = 0; i < m; i++) {
+        uint32_t k = args.shade_order[i];
+        const RayContrib* contrib = args.contrib_buffer + args.rays.path[k];
+        HitRecord& h = args.shade_records[i];
+        Ray ray = args.rays.get(k);
+        args.scene->surface(contrib->hit, ray.origin, ray.direction, h);
+        // the footprint of the ray cone at the hit point
+        // decides the level of detail of the textures
+        h.footprint = contrib->cone_spread * h.t + contrib->cone_width;
+    }
+    // evaluate the colors of each group at once, note
+    // that the offsets point to the end of each group
+    for (size_t g = 0, begin = 0; g < n_groups; begin = args.shade_offsets[g++]) {
+        const mtl::Material* mat = args.shade_materials[g];
+        size_t count = args.shade_offsets[g] - begin;
+        mat->attenuation(&args.shade_records[begin], count, &args.shade_attenuations[begin]);
+        mat->emittance(&args.shade_records[begin], count, &args.shade_emittances[begin]);
+    }
+}
+
 void Renderer::build_secondary_rays(
     RenderArgs& args
 ) const {
-    // compute all colors
-    // and build all scatter rays
-    for (size_t i = 0; i < args.buffer_length; i++) {
+    // compute all colors and build all scatter
+    // rays of the paths that are still active,
+    // note that the ray stream holds exactly one
+    // ray per active path and only the surviving
+    // paths are pushed into the next stream
+    for (size_t k = 0; k < args.rays.size(); k++) {
         // get the current contribution info
+        size_t i = args.rays.path[k];
         RayContrib* contrib = args.contrib_buffer + i;
-        HitRecord& h = contrib->hit_record;
-        // make sure the color is not final
-        if (contrib->is_final) { continue; }
-        // check if the hit record is valid, i.e.
-        // if the corresponding ray hit anything
-        if (h.is_valid) {
-            // get the attenuation and emittance
-            // color of the material at the hit point
-            Vec3f att = h.mat->attenuation(h);
-            Vec3f emit = h.mat->emittance(h);
+        // check if the corresponding ray hit anything
+        if (contrib->hit.type != PrimitiveType::None) {
+            // the hit record and the attenuation and
+            // emittance color of the material at the
+            // hit point were evaluated before
+            size_t slot = args.shade_slots[k];
+            const HitRecord& h = args.shade_records[slot];
+            const Vec3f& att = args.shade_attenuations[slot];
+            const Vec3f& emit = args.shade_emittances[slot];
             // update the color values
             // in the contribution buffer
             contrib->color = contrib->color + contrib->albedo * emit;
             contrib->albedo = contrib->albedo * att;
             // create the scatter ray
             // from the hit record
+            // note that the path ends if it reached
+            // the maximum recursion depth
             Ray scatter;
-            if (h.mat->scatter(h, scatter)) {
+            if ((contrib->depth + 1 < max_rdepth) && h.mat->scatter(h, scatter_sample(args, *contrib), scatter)) {
+                contrib->depth++;
                 // offset ray origin slightly to avoid 
                 // intersecting at the ray origin
                 scatter.origin = Vec3f::eps.fmadd(scatter.direction, scatter.origin);
-                // reset the hit record to
-                // reuse it for the scatter ray
-                h.is_valid = false; 
-                // set contribution of the scatter ray
-                // and push the ray into the queue
-                scatter.contrib = contrib;
-                args.rays.push_back(scatter);
+                // reset the hit to reuse
+                // it for the scatter ray
+                contrib->hit = Hit();
+                // the cone of the scatter ray starts with the
+                // footprint and keeps its spread, which holds
+                // for mirror reflections off flat surfaces
+                contrib->cone_width = h.footprint;
+                // the path survives the bounce
+                args.next_rays.push_back(scatter, i);
+                continue;
             }
-        } else {
-            // the ray corresponding to the
-            // contribution info did not hit
-            // any primitive
-            // contrib.color = contrib.color + contrib.albedo;
-            contrib->is_final = true;
         }
+        // the ray corresponding to the contribution
+        // info did either not hit any primitive or
+        // the hit material does not scatter, in both
+        // cases the path ends here and the slot might
+        // be taken over by a new camera sample
+        finish_path(args, i);
     }
+    // the next stream holds the rays
+    // of the next bounce
+    args.rays.swap(args.next_rays);
+    args.next_rays.clear();
 }
 
-void Renderer::render(FrameBuffer& fb) const 
-{
+void Renderer::render(FrameBuffer& fb) const {
+    // start the job and wait for it
+    render_async(fb)->wait();
+}
+
+std::unique_ptr<RenderJob> Renderer::render_async(FrameBuffer& fb) const {
     // compute the width and height of the viewport
     // to easily build the primary camera rays
     float vpw = 2.0f * tanf(0.5f * cam.fov());
-    float vph = vpw * (float)fb.height() / (float)fb.width();    
-
-    // worker function to render a single
-    // pixel of the camera
-    auto worker = [this, &vpw, &vph, &fb](
-        const size_t& i,
-        const size_t& j
-    ) {
-        // initialize a render args instance for the
-        // thread only once and reuse it for later executions
-        static thread_local RenderArgs args(rpp, bvh);
-        // add all the primary rays through
-        // the current pixel to the render args
-        build_pixel_rays(args, i, j, fb.width(), fb.height(), vpw, vph);
-        // render the pixel and reset the args
-        // to reuse them for the next pixel
-        render(args);
-        args.rays.clear();
-        // average the color over all rays
-        // that go through the current pixel
-        Vec3f c = Vec3f::zeros;
-        for (size_t k = 0; k < rpp; k++) {
-            RayContrib& contrib = args.contrib_buffer[k];
-            // reset contribution for the upcoming rays
-            c = c + contrib.color;
-            contrib = RayContrib();
-        }
-        c = c / (float)rpp;
-        // apply postprocessing including
-        // a simple approxiamtion of
-        // gamma correction filter
-        c = c.min(Vec3f::ones).max(Vec3f::zeros);
-        c = c.sqrt() * 255.0f;
-        // write the color to the framebuffer
-        fb.set_pixel(i, j, c[0], c[1], c[2]);
+    float vph = vpw * (float)fb.height() / (float)fb.width();
+    // split the image into tiles
+    std::unique_ptr<RenderJob> job(new RenderJob(fb));
+    for (size_t i = 0; i < fb.height(); i += _tile_size) {
+        for (size_t j = 0; j < fb.width(); j += _tile_size) {
+            // clip the tile at the image border
+            job->tiles.push_back({
+                i, j,
+                std::min(_tile_size, fb.height() - i),
+                std::min(_tile_size, fb.width() - j),
+                fb.height(), fb.width(),
+                vph, vpw
+            });
+        }
+    }
+    job->tile_done.assign(job->tiles.size(), 0);
+    // reset the counters of the previous call
+    job->cache_before = begin_stats();
+
+    // worker function to render a single tile of
+    // the image, the job waits for all its tiles
+    RenderJob* j = job.get();
+    auto worker = [this, j](const size_t& t, RenderArgs& args) {
+        // tiles of a cancelled job are skipped
+        if (!j->_cancelled) {
+            // fit the render args of the worker to the
+            // renderer and the scene local to its node
+            args.scene = &local_scene(args.node);
+            args.resize(_stream_size, bvh);
+            const RenderTile& tile = j->tiles[t];
+            args.cancel = &j->_cancelled;
+            bool complete = trace_tile(args, tile, rpp, 0);
+            args.cancel = nullptr;
+            // write the tile unless it was stopped
+            // before all of its samples were traced
+            finish_tile(j, t, complete? &args : nullptr);
+            return;
+        }
+        finish_tile(j, t, nullptr);
     };
 
-    // create a threadpool to manage the workers
-    ThreadPool pool(std::thread::hardware_concurrency());
-    // render all pixels
-    for (size_t i = 0; i < fb.height(); i++) {
-        for (size_t j = 0; j < fb.width(); j++) {
-            pool.enqueue(worker, i, j);
+    RenderContext& ctx = context();
+    size_t n_nodes = ctx.topology().n_nodes(), n_tiles = job->tiles.size();
+    if (_pipelining) {
+        // start the batches of paths on the nodes in turns with
+        // a tile each, the batches take further tiles on their own,
+        // each batch stays on its node and its buffers are only
+        // allocated by its first task such that they are placed
+        // on that node rather than on the one of the caller
+        size_t n_batches = std::min(n_tiles, pipeline_batches * ctx.n_workers());
+        job->next_tile = n_batches;
+        for (size_t b = 0; b < n_batches; b++) {
+            job->batches.emplace_back(new RenderArgs());
+            RenderArgs* batch = job->batches.back().get();
+            batch->node = b % n_nodes;
+            batch->cancel = &j->_cancelled;
+            ctx.submit([this, j, batch, b](RenderArgs&) { start_batch(j, batch, b); }, batch->node);
         }
+        return job;
     }
+    // hand all tiles to the workers of the context, each
+    // node gets a band of consecutive rows of tiles
+    for (size_t t = 0; t < n_tiles; t++) {
+        ctx.submit([worker, t](RenderArgs& args) { worker(t, args); }, t * n_nodes / n_tiles);
+    }
+    return job;
 }
 
-void Renderer::render(
+void Renderer::finish_tile(
+    RenderJob* job,
+    const size_t& t,
+    const RenderArgs* args
+) const {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    // write the pixels of a completed tile
+    if (args != nullptr) {
+        const RenderTile& tile = job->tiles[t];
+        for (size_t p = 0; p < args->pixel_colors.size(); p++) {
+            write_pixel(job->fb, tile.i + p / tile.width, tile.j + p % tile.width, args->pixel_colors[p], rpp);
+        }
+        job->tile_done[t] = 1;
+        job->n_rendered++;
+    }
+    // the last tile finishes the counters before it is
+    // counted, as done() reads the count without the lock
+    // and the stats have to be complete once it is true,
+    // then it wakes up all waiting threads, note that the
+    // job may be destroyed as soon as the lock is released
+    bool last = (job->n_finished + 1 == job->tiles.size());
+    if (last) { end_stats(job->cache_before); }
+    job->n_finished++;
+    if (last) { job->finished.notify_all(); }
+}
+
+void Renderer::start_batch(
+    RenderJob* job,
+    RenderArgs* batch,
+    size_t t
+) const {
+    // the index of the next tile is taken before the
+    // current one is finished, as finishing the last
+    // tile may destroy the job and with it the batch
+    size_t n_tiles = job->tiles.size();
+    while (t < n_tiles) {
+        if (!job->_cancelled) {
+            // fit the batch to the renderer and
+            // the scene local to its node
+            batch->scene = &local_scene(batch->node);
+            batch->resize(_stream_size, bvh);
+            begin_tile(*batch, job->tiles[t], rpp, 0);
+            build_pixel_rays(*batch);
+            context().submit([this, job, batch, t](RenderArgs&) { run_stage(job, batch, t, PipelineStage::Sort); }, batch->node);
+            return;
+        }
+        // skip the tiles of a cancelled job
+        size_t next = job->next_tile++;
+        finish_tile(job, t, nullptr);
+        t = next;
+    }
+}
+
+void Renderer::run_stage(
+    RenderJob* job,
+    RenderArgs* batch,
+    const size_t& t,
+    const PipelineStage& stage
+) const {
+    // hand the batch over to the next stage
+    auto submit = [this, job, batch, t](const PipelineStage& next) {
+        context().submit([this, job, batch, t, next](RenderArgs&) { run_stage(job, batch, t, next); }, batch->node);
+    };
+    // drop the paths of the batch once the job is
+    // cancelled, the tile is finished below
+    bool cancelled = *batch->cancel;
+    if (cancelled) {
+        batch->rays.clear();
+        batch->sorted_rays.clear();
+        batch->render_buckets.clear();
+    } else {
+        switch (stage) {
+            case PipelineStage::Sort:
+                // reorder the rays and sort
+                // them into render buckets
+                if (_reordering) { reorder_rays(*batch); }
+                sort_rays_into_buckets(*batch);
+                submit(PipelineStage::Intersect);
+                return;
+            case PipelineStage::Intersect:
+                // compute all closest hit-records
+                flush_buckets(*batch);
+                submit(PipelineStage::Shade);
+                return;
+            case PipelineStage::Shade:
+                // evaluate the materials and build the
+                // next bounce, which starts a new wave
+                // of camera rays if all paths ended
+                shade_hits(*batch);
+                build_secondary_rays(*batch);
+                if (batch->rays.empty()) { build_pixel_rays(*batch); }
+                if (!batch->rays.empty()) {
+                    submit(PipelineStage::Sort);
+                    return;
+                }
+                break;
+        }
+    }
+    // the tile is done, take the next one before
+    // finishing it and carry on with the next one
+    end_tile(*batch);
+    size_t next = job->next_tile++;
+    size_t n_tiles = job->tiles.size();
+    finish_tile(job, t, cancelled? nullptr : batch);
+    if (next < n_tiles) { start_batch(job, batch, next); }
+}
+
+BudgetedRender Renderer::render(
+    FrameBuffer& fb,
+    const double& seconds
+) const {
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    auto deadline = start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+    auto elapsed = [&start](void) {
+        return std::chrono::duration<double>(clock::now() - start).count();
+    };
+    // compute the width and height of the viewport
+    // to easily build the primary camera rays
+    float vpw = 2.0f * tanf(0.5f * cam.fov());
+    float vph = vpw * (float)fb.height() / (float)fb.width();
+    // split the image into tiles
+    std::vector<RenderTile> tiles;
+    for (size_t i = 0; i < fb.height(); i += _tile_size) {
+        for (size_t j = 0; j < fb.width(); j += _tile_size) {
+            tiles.push_back({
+                i, j,
+                std::min(_tile_size, fb.height() - i),
+                std::min(_tile_size, fb.width() - j),
+                fb.height(), fb.width(),
+                vph, vpw
+            });
+        }
+    }
+    // nothing to render for an empty image
+    if (tiles.empty()) { return BudgetedRender(); }
+    // the sums of the colors of all pixels over all
+    // passes and the samples per pixel of each tile
+    std::vector<Vec3f> sums(fb.height() * fb.width(), Vec3f::zeros);
+    std::vector<size_t> tile_spp(tiles.size(), 0);
+
+    // worker function adding a pass with the given
+    // samples per pixel to a single tile, the samples
+    // continue the sequences of the previous passes
+    auto worker = [this, &fb, &tiles, &sums, &tile_spp, &deadline](const size_t& t, const size_t& spp, RenderArgs& args) {
+        // skip the tile once the deadline passed,
+        // unless it did not get any sample yet
+        if ((tile_spp[t] > 0) && (clock::now() >= deadline)) { return; }
+        // fit the render args of the worker to the
+        // renderer and the scene local to its node
+        args.scene = &local_scene(args.node);
+        args.resize(_stream_size, bvh);
+        const RenderTile& tile = tiles[t];
+        trace_tile(args, tile, spp, tile_spp[t]);
+        for (size_t p = 0; p < args.pixel_colors.size(); p++) {
+            size_t k = (tile.i + p / tile.width) * fb.width() + tile.j + p % tile.width;
+            sums[k] = sums[k] + args.pixel_colors[p];
+        }
+        tile_spp[t] += spp;
+    };
+
+    BudgetedRender result;
+    txr::TileCacheStats before = begin_stats();
+    {
+        // the largest passes fill the ray
+        // stream of a worker with a single tile
+        size_t max_pass_spp = std::max<size_t>(1, _stream_size / (_tile_size * _tile_size));
+        // the samples per pixel reached by all
+        // tiles and the size of the next pass
+        size_t spp = 0, pass_spp = 1;
+        RenderContext& ctx = context();
+        size_t n_nodes = ctx.topology().n_nodes();
+        for (;;) {
+            // add the pass to all tiles and wait for the
+            // pass to finish, each node gets a band of
+            // tiles as for the other render calls
+            std::vector<std::future<void>> pass;
+            for (size_t t = 0; t < tiles.size(); t++) {
+                auto task = [&worker, t, pass_spp](RenderArgs& args) { worker(t, pass_spp, args); };
+                pass.push_back(ctx.submit(task, t * n_nodes / tiles.size()));
+            }
+            for (std::future<void>& f : pass) { f.wait(); }
+            result.n_passes++;
+            // remaining tiles were skipped if the pass
+            // was cut off by the deadline
+            double remaining = seconds - elapsed();
+            if (remaining <= 0.0) { break; }
+            spp += pass_spp;
+            // double the passes to keep the share of partly
+            // filled ray streams small, but never plan more
+            // samples than the past rate allows in the time
+            // that is left, such that the passes get shorter
+            // towards the deadline and the pass that is cut
+            // off only adds a single sample to some tiles
+            double seconds_per_spp = elapsed() / spp;
+            size_t fit = (size_t)(remaining / seconds_per_spp);
+            pass_spp = std::max<size_t>(1, std::min({ 2 * pass_spp, max_pass_spp, fit }));
+        }
+    }
+    end_stats(before);
+    // write the average colors of all pixels, the
+    // tiles of the last pass may have more samples
+    result.spp = *std::min_element(tile_spp.begin(), tile_spp.end());
+    result.max_spp = *std::max_element(tile_spp.begin(), tile_spp.end());
+    for (size_t t = 0; t < tiles.size(); t++) {
+        const RenderTile& tile = tiles[t];
+        result.n_samples += tile_spp[t] * tile.height * tile.width;
+        for (size_t i = tile.i; i < tile.i + tile.height; i++) {
+            for (size_t j = tile.j; j < tile.j + tile.width; j++) {
+                write_pixel(fb, i, j, sums[i * fb.width() + j], tile_spp[t]);
+            }
+        }
+    }
+    result.seconds = elapsed();
+    return result;
+}
+
+void Renderer::begin_tile(
+    RenderArgs& args,
+    const RenderTile& tile,
+    const size_t& spp,
+    const size_t& first_sample
+) const {
+    // set up the render args for the tile
+    size_t n_pixels = tile.height * tile.width;
+    args.tile = tile;
+    args.pixel_colors.assign(n_pixels, Vec3f::zeros);
+    args.n_samples = n_pixels * spp;
+    args.next_sample = 0;
+    args.pixel_samples = spp;
+    args.first_sample = first_sample;
+    args.stats = RenderStats();
+}
+
+void Renderer::end_tile(
+    RenderArgs& args
+) const {
+    // add the counters of the tile to the
+    // counters of the render call
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        _stats.n_rays += args.stats.n_rays;
+        _stats.n_leaf_visits += args.leaf_sort.n_leaf_visits;
+        _stats.n_leaf_hits += args.leaf_sort.n_leaf_hits;
+    }
+    args.leaf_sort.n_leaf_visits = 0;
+    args.leaf_sort.n_leaf_hits = 0;
+}
+
+bool Renderer::trace_tile(
+    RenderArgs& args,
+    const RenderTile& tile,
+    const size_t& spp,
+    const size_t& first_sample
+) const {
+    // trace all samples of the tile
+    begin_tile(args, tile, spp, first_sample);
+    bool complete = render(args);
+    end_tile(args);
+    return complete;
+}
+
+void Renderer::render_tile(
+    RenderArgs& args,
+    const RenderTile& tile,
+    FrameBuffer& fb
+) const {
+    // trace all samples of the tile
+    args.scene = &scene;
+    trace_tile(args, tile, rpp, 0);
+    // write the pixels of the tile
+    for (size_t p = 0; p < args.pixel_colors.size(); p++) {
+        write_pixel(fb, tile.i + p / tile.width, tile.j + p % tile.width, args.pixel_colors[p], rpp);
+    }
+}
+
+bool Renderer::render(
     RenderArgs& args
 ) const {
-    // main rendering loop iterating until the
-    // ray queue is empty or the maximum recursion
-    // depth is reached
-    size_t rdepth = 0;
-    while ((!args.rays.empty()) && (rdepth++ < max_rdepth)) {
-        // sort the rays from the ray queue
-        // into render buckets
-        sort_rays_into_buckets(args);
-        // flush the render buckets, i.e.
-        // compute all closest hit-records
-        flush_buckets(args);
-        // fill the queue with scatter
-        // rays from the current iteration
-        build_secondary_rays(args);
+    // process the samples of the tile in waves that
+    // fill the contribution buffer, note that with
+    // path regeneration enabled the first wave keeps
+    // the buffer full until the budget is used up
+    while (args.next_sample < args.n_samples) {
+        // fill the contribution buffer
+        // with primary camera rays
+        build_pixel_rays(args);
+        // main rendering loop iterating until
+        // all paths of the wave are finished
+        while (!args.rays.empty()) {
+            // drop all paths in flight once
+            // the render call is cancelled
+            if ((args.cancel != nullptr) && *args.cancel) {
+                args.rays.clear();
+                return false;
+            }
+            // reorder the rays to make
+            // neighbours coherent
+            if (_reordering) { reorder_rays(args); }
+            // sort the rays from the ray queue
+            // into render buckets
+            sort_rays_into_buckets(args);
+            // flush the render buckets, i.e.
+            // compute all closest hit-records
+            flush_buckets(args);
+            // evaluate the materials at the hits
+            shade_hits(args);
+            // fill the queue with scatter
+            // rays from the current iteration
+            build_secondary_rays(args);
+        }
     }
+    return true;
 }
@@ -3,23 +3,72 @@
 
 // forward declarations
 class FrameBuffer;
+class RenderContext;
 // includes
+#include <mutex>
+#include <atomic>
+#include <memory>
 #include <vector>
+#include <cstdint>
+#include <condition_variable>
 #include "./ray.hpp"
 #include "./bvh.hpp"
 #include "./scene.hpp"
 #include "./camera.hpp"
 #include "./primitive.hpp"
+#include "./sampler.hpp"
+#include "./tilecache.hpp"
 
-// structure holding the rays and the
-// primitive of a render bucket
+// structure holding the range of sorted
+// rays and the leaf of a render bucket
 typedef struct RenderBucket {
-    RayQueue& rays;
-    const Primitive* prim;
+    size_t begin, end;
+    size_t leaf_id;
 } RenderBucket;
 // shortcut for a queue of render buckets
 using RenderQueue = std::vector<RenderBucket>;
 
+// counters collected while rendering
+typedef struct RenderStats {
+    // number of rays sorted into the hierarchy
+    size_t n_rays = 0;
+    // number of (ray, leaf) pairs found during
+    // traversal and the number of pairs whose leaf
+    // was also visited by the previous ray
+    size_t n_leaf_visits = 0;
+    size_t n_leaf_hits = 0;
+    // lookups of the tile cache of the textures
+    txr::TileCacheStats tile_cache;
+} RenderStats;
+
+// result of a render call with a time budget
+typedef struct BudgetedRender {
+    // samples per pixel reached by every pixel and by
+    // the pixels that got the most samples, these differ
+    // if the deadline was hit in the middle of a pass
+    size_t spp = 0;
+    size_t max_spp = 0;
+    // number of camera samples over all pixels
+    size_t n_samples = 0;
+    // number of started passes and the time
+    // taken by the call in seconds
+    size_t n_passes = 0;
+    double seconds = 0.0;
+} BudgetedRender;
+
+// rectangular tile of the image that
+// is rendered by a single worker
+typedef struct RenderTile {
+    // position of the top-left pixel
+    // and size of the tile in pixels
+    size_t i, j;
+    size_t height, width;
+    // size of the full image and
+    // of the camera viewport
+    size_t img_height, img_width;
+    float vph, vpw;
+} RenderTile;
+
 // struct holding all arguments
 // needed to render the contained
 // rays and all their scatter rays
@@ -30,23 +79,152 @@ typedef struct RenderArgs {
     RayContrib* contrib_buffer;
     // the length of the contribution buffer
     size_t buffer_length;
-    // all primary rays through the pixel
-    // and secondary rays generated from them
-    RayQueue rays;
+    // the rays of the current bounce with one
+    // ray per active path, the path indices of
+    // the stream form a compact list of the
+    // active slots of the contribution buffer
+    RayStream rays;
+    // the rays of the next bounce built
+    // while shading the current one
+    RayStream next_rays;
+    // morton keys and ray indices used to
+    // reorder the rays before traversal
+    std::vector<std::pair<uint32_t, uint32_t>> ray_keys;
+    std::vector<std::pair<uint32_t, uint32_t>> ray_keys_tmp;
     // the rays sorted by the leafs of the
-    // bounding volume hierarchy
-    std::vector<RayQueue> sorted_rays;
+    // bounding volume hierarchy into a single
+    // flat array and the scratch memory of
+    // the counting sort
+    RayStream sorted_rays;
+    LeafSortBuffer leaf_sort;
     // the queue of render buckets that
     // are yet to processed by the renderer
     RenderQueue render_buckets;
-    // constructor and destructor
+    // the distinct materials hit by the rays of the
+    // current bounce, the end of the hits of each
+    // material, the material and ray of each hit and
+    // the rays grouped by material, the hit records
+    // and colors are built in that order such that the
+    // textures of all hits of a material are evaluated
+    // at once, the slots give the position of each ray
+    std::vector<const mtl::Material*> shade_materials;
+    std::vector<size_t> shade_offsets;
+    std::vector<std::pair<uint32_t, uint32_t>> shade_keys;
+    std::vector<uint32_t> shade_order;
+    std::vector<uint32_t> shade_slots;
+    std::vector<HitRecord> shade_records;
+    std::vector<Vec3f> shade_attenuations;
+    std::vector<Vec3f> shade_emittances;
+    // the tile that is currently rendered
+    // and the accumulated color of each
+    // of its pixels
+    RenderTile tile;
+    std::vector<Vec3f> pixel_colors;
+    // the sample budget of the tile, the index of
+    // the next camera sample, the number of samples
+    // per pixel and the sample index of the sequence
+    // of each pixel the first of them starts at
+    size_t n_samples;
+    size_t next_sample;
+    size_t pixel_samples;
+    size_t first_sample;
+    // counters of the current tile
+    RenderStats stats;
+    // the scene the rays are cast against, which
+    // may be a replica local to the node of the
+    // worker, and the numa node of the worker
+    const Scene* scene = nullptr;
+    size_t node = 0;
+    // flag set when the render call is cancelled,
+    // which stops the tile after the current bounce
+    const std::atomic<bool>* cancel = nullptr;
+    // constructors and destructor, the default
+    // constructor leaves all buffers empty
+    RenderArgs(void);
     RenderArgs(
         const size_t& n_rays,
         const BVH& bvh
     );
     ~RenderArgs(void);
+    // the buffers hold pointers to each other
+    RenderArgs(const RenderArgs&) = delete;
+    RenderArgs& operator=(const RenderArgs&) = delete;
+    // fit the buffers to the given number of paths
+    // traced at once and to the leafs of the given
+    // hierarchy, nothing is allocated if they fit
+    void resize(
+        const size_t& n_rays,
+        const BVH& bvh
+    );
 } RenderArgs;
 
+// the stages a batch of paths goes through per
+// bounce in the pipelined mode of the renderer
+enum class PipelineStage {
+    Sort,       // reorder the rays and sort them into buckets
+    Intersect,  // cast the rays of all buckets
+    Shade       // shade the hits and build the next bounce
+};
+
+// handle of a render call running in the background,
+// the tiles are rendered by the workers of the context
+// of the renderer and written to the framebuffer as soon
+// as they are done
+class RenderJob {
+private:
+    // the renderer has access to the
+    // internals of the job
+    friend class Renderer;
+    // the framebuffer the tiles are written
+    // to, it must outlive the job
+    FrameBuffer& fb;
+    // the tiles of the image and whether each
+    // of them is written to the framebuffer
+    std::vector<RenderTile> tiles;
+    std::vector<uint8_t> tile_done;
+    // number of written tiles and of tiles
+    // that were either written or skipped
+    std::atomic<size_t> n_rendered;
+    std::atomic<size_t> n_finished;
+    std::atomic<bool> _cancelled;
+    // the counters of the tile cache
+    // at the start of the job
+    txr::TileCacheStats cache_before;
+    // the batches of paths of the pipelined mode
+    // and the index of the next tile to start
+    std::vector<std::unique_ptr<RenderArgs>> batches;
+    std::atomic<size_t> next_tile;
+    // guards the framebuffer, the done flags and the
+    // count of finished tiles and signals the end of
+    // the job to waiting threads
+    mutable std::mutex mutex;
+    std::condition_variable finished;
+    // constructor, only used by the renderer
+    RenderJob(FrameBuffer& fb);
+public:
+    // the destructor cancels the job and
+    // waits for its remaining tiles
+    ~RenderJob(void);
+    // fraction of the tiles that are written
+    float progress(void) const;
+    // check if all tiles are either written
+    // or skipped and if the job was cancelled
+    bool done(void) const;
+    bool cancelled(void) const;
+    // stop the job, tiles that are not started
+    // are skipped and the running ones stop
+    // after their current bounce
+    void cancel(void);
+    // block until the job is done and return
+    // true if all tiles were written
+    bool wait(void);
+    // copy the tiles written so far to the given
+    // framebuffer of the same size, the other
+    // pixels are left untouched, returns the
+    // number of copied tiles
+    size_t partial(FrameBuffer& out) const;
+};
+
 class Renderer {
 private:
     // references to objects that are heavily
@@ -54,37 +232,155 @@ private:
     const Scene& scene;
     const Camera& cam;
     const BVH& bvh;
-    const PrimitiveList& primitives; 
     // number of rays per pixel
     size_t rpp;
     // maximum number of secondary
     // rays per primary ray
     size_t max_rdepth;
+    // size of the (square) image tiles
+    // and the number of paths traced
+    // simultaneously by a worker
+    size_t _tile_size = 8;
+    size_t _stream_size = 1024;
+    // refill the slot of a finished
+    // path with a new camera sample
+    bool _regeneration = false;
+    // reorder rays by their morton
+    // keys before traversal
+    bool _reordering = false;
+    // run the stages of the bounces of
+    // several batches of paths as tasks
+    bool _pipelining = false;
+    // prefetch the nodes and packets the
+    // traversal and the leafs will read
+    bool _prefetching = true;
+    // the sampler providing the pixel positions
+    // and the random numbers of each bounce
+    const Sampler* _sampler;
+    // the workers the tiles are rendered by,
+    // the global context if none is set
+    RenderContext* _context = nullptr;
+    // the cache the textures of the scene are
+    // read through, only used for its counters
+    txr::TileCache* _tile_cache = nullptr;
+    // counters of the last render call
+    mutable RenderStats _stats;
+    mutable std::mutex stats_mutex;
+    // the replicas of the scene per numa node built
+    // on demand if the context replicates the scenes
+    // and whether the replica of a node was built
+    mutable std::vector<std::unique_ptr<Scene>> replicas;
+    mutable std::vector<bool> has_replica;
+    mutable std::mutex replica_mutex;
+
+    // get the scene or its replica on the given node
+    const Scene& local_scene(const size_t& node) const;
+    // count a tile of the job as finished and write its
+    // pixels from the given render args unless null
+    void finish_tile(
+        RenderJob* job,
+        const size_t& t,
+        const RenderArgs* args
+    ) const;
+    // pipelined mode: start the given tile, or the next one
+    // that is not skipped, on the batch and run the given
+    // stage of the current bounce of the batch, each stage
+    // submits the next one as a new task to the node of
+    // the batch, the first tile allocates the buffers
+    void start_batch(
+        RenderJob* job,
+        RenderArgs* batch,
+        size_t t
+    ) const;
+    void run_stage(
+        RenderJob* job,
+        RenderArgs* batch,
+        const size_t& t,
+        const PipelineStage& stage
+    ) const;
+
+    // reset the counters before a render call and
+    // return the counters of the tile cache, which
+    // are turned into the counts of the call after
+    txr::TileCacheStats begin_stats(void) const;
+    void end_stats(const txr::TileCacheStats& before) const;
+    // set up the render args to trace the given number
+    // of samples per pixel of the tile and add the
+    // counters of the tile to the render call after
+    void begin_tile(
+        RenderArgs& args,
+        const RenderTile& tile,
+        const size_t& spp,
+        const size_t& first_sample
+    ) const;
+    void end_tile(
+        RenderArgs& args
+    ) const;
+    // trace the given number of samples per pixel of
+    // the tile starting at the given sample index of
+    // each pixel, the sums of the colors of each pixel
+    // are left in the pixel colors of the render args,
+    // returns false if the tile was cancelled
+    bool trace_tile(
+        RenderArgs& args,
+        const RenderTile& tile,
+        const size_t& spp,
+        const size_t& first_sample
+    ) const;
 
+    // build the next camera sample of the
+    // current tile into the given slot of
+    // the contribution buffer, push its ray
+    // to the given stream and return
+    // false if the sample budget is used up
+    bool build_camera_ray(
+        RenderArgs& args,
+        const size_t& slot,
+        RayStream& stream
+    ) const;
+    // draw the numbers picking the lobe and the
+    // direction of the next bounce of a path
+    Vec3f scatter_sample(
+        const RenderArgs& args,
+        const RayContrib& contrib
+    ) const;
+    // accumulate the color of a finished path
+    // and regenerate its slot if enabled, returns
+    // true if the slot holds a new active path
+    bool finish_path(
+        RenderArgs& args,
+        const size_t& slot
+    ) const;
     // steps of the rendering pipeline
-    // 1) build all primary camera rays
-    // through a specific pixel and push
-    // them into the render chunk
+    // 1) build primary camera rays of the
+    // current tile into all free slots of
+    // the contribution buffer
     void build_pixel_rays(
-        RenderArgs& args,
-        const size_t& i,
-        const size_t& j,
-        const size_t& width,
-        const size_t& height,
-        const float& vpw,
-        const float& vph
-    ) const;
-    // 2) sort the rays that are currently
+        RenderArgs& args
+    ) const;
+    // 2) reorder the rays in the ray queue
+    // by a morton key of their origin and
+    // the octant of their direction
+    void reorder_rays(
+        RenderArgs& args
+    ) const;
+    // 3) sort the rays that are currently
     // stored in the ray queue into
     // render buckets
     void sort_rays_into_buckets(
         RenderArgs& args
     ) const;
-    // 3) flush the render buckets 
+    // 4) flush the render buckets 
     void flush_buckets(
         RenderArgs& args
     ) const;
-    // 4) compute the color of each ray
+    // 5) build the hit records of all rays and
+    //    evaluate their materials grouped by
+    //    material in batches
+    void shade_hits(
+        RenderArgs& args
+    ) const;
+    // 6) compute the color of each ray
     //    and build the secondary rays
     void build_secondary_rays(
         RenderArgs& args
@@ -97,11 +393,61 @@ public:
         const size_t& rpp,
         const size_t& max_rdepth
     );
+    // getters & setters
+    const size_t& tile_size(void) const;
+    const size_t& stream_size(void) const;
+    const bool& regeneration(void) const;
+    const bool& reordering(void) const;
+    const bool& pipelining(void) const;
+    const bool& prefetching(void) const;
+    void tile_size(const size_t& new_tile_size);
+    void stream_size(const size_t& new_stream_size);
+    void regeneration(const bool& new_regeneration);
+    void reordering(const bool& new_reordering);
+    // split the paths into batches whose sort, intersect and
+    // shade stages run as separate tasks on the workers, such
+    // that the stages of different batches overlap
+    void pipelining(const bool& new_pipelining);
+    // prefetch the children of the nodes hit during
+    // traversal and the packets of the next leaf while
+    // casting the rays of a leaf, does not change the image
+    void prefetching(const bool& new_prefetching);
+    // the sampler must outlive the renderer
+    const Sampler& sampler(void) const;
+    void sampler(const Sampler& new_sampler);
+    // the context must outlive the renderer
+    RenderContext& context(void) const;
+    void context(RenderContext& new_context);
+    // report the lookups of the given cache
+    // in the counters of each render call
+    void tile_cache(txr::TileCache* cache);
+    // get the counters of the last render call
+    RenderStats stats(void) const;
     // render pipeline
     void render(FrameBuffer& fb) const;
-    // apply the full rendering pipeline
-    // to the given render arguments
-    void render(RenderArgs& args) const;
+    // start rendering in the background and return
+    // the handle of the job, the counters of the
+    // renderer refer to the last started job
+    std::unique_ptr<RenderJob> render_async(FrameBuffer& fb) const;
+    // render progressive passes over the whole image
+    // until the time budget in seconds is used up, the
+    // number of samples per pixel of the renderer is
+    // ignored, every pixel gets at least one sample
+    BudgetedRender render(
+        FrameBuffer& fb,
+        const double& seconds
+    ) const;
+    // render a single tile of the image
+    void render_tile(
+        RenderArgs& args,
+        const RenderTile& tile,
+        FrameBuffer& fb
+    ) const;
+    // apply the full rendering pipeline to the
+    // given render arguments, returns false if the
+    // render call was cancelled before all samples
+    // of the tile were traced
+    bool render(RenderArgs& args) const;
 };
 
 #endif // H_RENDERER
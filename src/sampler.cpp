@@ -0,0 +1,223 @@
+#include "./sampler.hpp"
+#include <rng.hpp>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+// helper function reversing the order
+// of the bits of a 32-bit integer
+inline uint32_t reverse_bits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// integer hash mixing all bits of the input
+inline uint32_t hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+inline uint32_t hash(const uint32_t& a, const uint32_t& b) {
+    return hash(a ^ (hash(b) + 0x9e3779b9u + (a << 6) + (a >> 2)));
+}
+
+// nested uniform scrambling of the bits of x, i.e. each bit
+// is flipped depending on the bits above it, the permutation
+// of the bit-reversed value only lets lower bits influence
+// higher ones (laine and karras, improved by burley)
+inline uint32_t nested_uniform_scramble(uint32_t x, const uint32_t& seed) {
+    x = reverse_bits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverse_bits(x);
+}
+
+// the first two dimensions of the sobol sequence, the first
+// one is the van der corput sequence and the direction numbers
+// of the second one follow from v_i = v_{i-1} ^ (v_{i-1} >> 1)
+inline uint32_t sobol(uint32_t index, const uint32_t& dim) {
+    if (dim == 0) { return reverse_bits(index); }
+    uint32_t x = 0;
+    for (uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+        if (index & 1u) { x ^= v; }
+    }
+    return x;
+}
+
+// map the bits to [0, 1) without rounding up to one
+inline float to_unit(const uint32_t& x) {
+    return std::min(x * 0x1p-32f, 0x1.fffffep-1f);
+}
+
+// the coordinate of a scrambled sobol point, the pair of the
+// dimension shuffles the indices and each dimension has its
+// own scrambling of the coordinates
+inline float scrambled_sobol(
+    const uint32_t& index,
+    const uint32_t& dim,
+    const uint32_t& seed
+) {
+    uint32_t i = nested_uniform_scramble(index, hash(seed, dim / 2));
+    return to_unit(nested_uniform_scramble(sobol(i, dim % 2), hash(seed ^ 0x5bd1e995u, dim)));
+}
+
+/*
+ *  Random Sampler
+ */
+
+float RandomSampler::get(
+    const uint32_t& x,
+    const uint32_t& y,
+    const uint32_t& index,
+    const uint32_t& dim
+) const {
+    return rng::randf();
+}
+
+
+/*
+ *  Sobol Sampler
+ */
+
+SobolSampler::SobolSampler(const uint32_t& seed) :
+    seed(seed) {}
+
+float SobolSampler::get(
+    const uint32_t& x,
+    const uint32_t& y,
+    const uint32_t& index,
+    const uint32_t& dim
+) const {
+    // every pixel scrambles the sequence differently
+    return scrambled_sobol(index, dim, hash(hash(seed, x), y));
+}
+
+
+/*
+ *  Blue-Noise Sampler
+ */
+
+// build a tileable blue-noise mask of size n x n by the void
+// and cluster method of ulichney, the mask orders the pixels
+// by inserting each into the largest void of the ones before
+static std::vector<float> void_and_cluster(
+    const size_t& n,
+    const uint32_t& seed
+) {
+    const size_t n_pixels = n * n;
+    const float sigma = 1.5f;
+    // gaussian weights of all offsets on the torus
+    std::vector<float> weights(n_pixels);
+    for (size_t dy = 0; dy < n; dy++) {
+        for (size_t dx = 0; dx < n; dx++) {
+            float ex = std::min(dx, n - dx), ey = std::min(dy, n - dy);
+            weights[dy * n + dx] = expf(-(ex * ex + ey * ey) / (2.0f * sigma * sigma));
+        }
+    }
+    // the set pixels and the energy of each
+    // pixel due to all set pixels
+    std::vector<uint8_t> is_set(n_pixels, 0);
+    std::vector<float> energy(n_pixels, 0.0f);
+    auto toggle = [&](const size_t& p) {
+        float sign = is_set[p]? -1.0f : 1.0f;
+        is_set[p] ^= 1;
+        size_t px = p % n, py = p / n;
+        for (size_t qy = 0; qy < n; qy++) {
+            const float* row = weights.data() + ((qy + n - py) % n) * n;
+            float* e = energy.data() + qy * n;
+            for (size_t qx = 0; qx < n; qx++) {
+                e[qx] += sign * row[(qx >= px)? qx - px : qx + n - px];
+            }
+        }
+    };
+    // the set pixel with the highest energy and
+    // the free pixel with the lowest energy
+    auto tightest_cluster = [&](void) {
+        size_t best = 0;
+        float e = -1.0f;
+        for (size_t p = 0; p < n_pixels; p++) {
+            if (is_set[p] && (energy[p] > e)) { best = p; e = energy[p]; }
+        }
+        return best;
+    };
+    auto largest_void = [&](void) {
+        size_t best = 0;
+        float e = std::numeric_limits<float>::infinity();
+        for (size_t p = 0; p < n_pixels; p++) {
+            if (!is_set[p] && (energy[p] < e)) { best = p; e = energy[p]; }
+        }
+        return best;
+    };
+    // random initial pattern setting a tenth of the pixels
+    size_t n_initial = n_pixels / 10;
+    uint32_t h = seed;
+    for (size_t k = 0; k < n_initial;) {
+        h = hash(h + 1);
+        size_t p = h % n_pixels;
+        if (!is_set[p]) { toggle(p); k++; }
+    }
+    // move the pixels of the tightest clusters into the
+    // largest voids until the pattern does not change
+    for (size_t k = 0; k < n_pixels; k++) {
+        size_t c = tightest_cluster();
+        toggle(c);
+        size_t v = largest_void();
+        toggle(v);
+        if (v == c) { break; }
+    }
+    // rank the initial pixels by removing the tightest
+    // clusters one after the other, then restore them
+    std::vector<size_t> rank(n_pixels);
+    std::vector<size_t> initial;
+    for (size_t r = n_initial; r > 0; r--) {
+        size_t c = tightest_cluster();
+        rank[c] = r - 1;
+        initial.push_back(c);
+        toggle(c);
+    }
+    for (const size_t& p : initial) { toggle(p); }
+    // rank the remaining pixels by filling the largest
+    // voids, once more than half of the pixels are set
+    // this fills the tightest clusters of free pixels
+    for (size_t r = n_initial; r < n_pixels; r++) {
+        size_t v = largest_void();
+        rank[v] = r;
+        toggle(v);
+    }
+    // the ranks give the values of the mask
+    std::vector<float> mask(n_pixels);
+    for (size_t p = 0; p < n_pixels; p++) { mask[p] = (rank[p] + 0.5f) / n_pixels; }
+    return mask;
+}
+
+BlueNoiseSampler::BlueNoiseSampler(const uint32_t& seed) :
+    seed(seed),
+    mask(void_and_cluster(mask_size, seed))
+{
+}
+
+float BlueNoiseSampler::get(
+    const uint32_t& x,
+    const uint32_t& y,
+    const uint32_t& index,
+    const uint32_t& dim
+) const {
+    // shift the mask per dimension to decorrelate
+    // the rotations of the dimensions
+    uint32_t shift = hash(seed, dim);
+    size_t mx = (x + (shift & 0xffffu)) % mask_size;
+    size_t my = (y + (shift >> 16)) % mask_size;
+    // rotate the shared sequence by the mask
+    float u = scrambled_sobol(index, dim, seed) + mask[my * mask_size + mx];
+    return (u >= 1.0f)? u - 1.0f : u;
+}
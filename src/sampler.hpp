@@ -0,0 +1,81 @@
+#ifndef H_SAMPLER
+#define H_SAMPLER
+
+// includes
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// source of the random numbers of the paths, each sample of
+// a pixel is a point in a high dimensional unit cube whose
+// coordinates are requested one dimension at a time, the
+// dimensions 2k and 2k + 1 are meant to be used as a pair
+class Sampler {
+public:
+    virtual ~Sampler(void) = default;
+    // get the coordinate of the sample with the given
+    // index of the pixel (x, y) in the given dimension
+    virtual float get(
+        const uint32_t& x,
+        const uint32_t& y,
+        const uint32_t& index,
+        const uint32_t& dim
+    ) const = 0;
+};
+
+// independent uniform random numbers
+class RandomSampler : public Sampler {
+public:
+    virtual float get(
+        const uint32_t& x,
+        const uint32_t& y,
+        const uint32_t& index,
+        const uint32_t& dim
+    ) const;
+};
+
+// sobol sequence with nested uniform (owen) scrambling, each
+// pair of dimensions uses the first two sobol dimensions with
+// its own shuffle of the sample indices and its own scrambling,
+// such that any prefix of the samples of a pixel is well
+// stratified in every pair, the scrambling seeds differ per
+// pixel which leaves the error between pixels uncorrelated
+class SobolSampler : public Sampler {
+private:
+    uint32_t seed;
+public:
+    // constructor
+    SobolSampler(const uint32_t& seed = 0);
+    virtual float get(
+        const uint32_t& x,
+        const uint32_t& y,
+        const uint32_t& index,
+        const uint32_t& dim
+    ) const;
+};
+
+// the same scrambled sobol sequence for all pixels, rotated
+// per pixel by the values of a blue-noise mask shifted per
+// dimension, which distributes the error of neighbouring
+// pixels as blue noise that is hardly visible at low counts
+class BlueNoiseSampler : public Sampler {
+private:
+    uint32_t seed;
+    // the blue-noise mask holding the
+    // values in [0, 1) row by row
+    std::vector<float> mask;
+public:
+    // size of the tileable mask
+    static constexpr size_t mask_size = 64;
+    // constructor, builds the mask
+    // by the void and cluster method
+    BlueNoiseSampler(const uint32_t& seed = 0);
+    virtual float get(
+        const uint32_t& x,
+        const uint32_t& y,
+        const uint32_t& index,
+        const uint32_t& dim
+    ) const;
+};
+
+#endif // H_SAMPLER
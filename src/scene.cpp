@@ -1,62 +1,434 @@
 #include "./scene.hpp"
 #include "./primitive.hpp"
+#include <cstdio>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-void Scene::init(const BoundableList& objects)
-{
+void Scene::init(
+    const Mesh& mesh,
+    const BoundableList& objects,
+    const TriangleKernel& kernel
+) {
+    // the triangle kernel decides the
+    // layout of the triangle packets
+    _triangles = TriangleCollection(kernel);
+    // collect the bounding boxes of all primitives,
+    // the triangles of the mesh are referred to by
+    // their index and the objects follow behind them
+    size_t n_mesh = mesh.size();
+    std::vector<AABB> bounds;
+    bounds.reserve(n_mesh + objects.size());
+    for (size_t t = 0; t < n_mesh; t++) { bounds.push_back(mesh.bound(t)); }
+    for (const Boundable* obj : objects) { bounds.push_back(obj->bound()); }
     // build the bounding volume hierarchy
-    _bvh = new BVH(objects, 16, 8);
-    // build the primitives of each leaf node
-    // of the bounding volume hierarchy
+    _bvh = _arena.create<BVH>(bounds, 16, 8);
+    // copy the primitives of each leaf node of
+    // the bounding volume hierarchy into the
+    // flat packet arrays
     for (size_t i = 0; i < _bvh->num_leafs(); i++) {
-        // get the list of boundable objects that
-        // is assigned to the current leaf
-        const BoundableList& objs = _bvh->get_leaf_objects(i);
-        // create collections for the different
-        // primitive types
-        TriangleCollection* tris = new TriangleCollection;
-        SphereCollection* spheres = new SphereCollection;
-        // sort all objects into their respective
-        // primitive collection
-        for (const Boundable* obj : objs) {
-            // triangle
+        // the packets of the leaf start
+        // at the end of the arrays
+        SceneLeaf leaf;
+        leaf.tri_begin = _triangles.n_packets();
+        leaf.sph_begin = _spheres.n_packets();
+        // sort all primitives assigned to the leaf
+        // into their respective primitive collection
+        for (const uint32_t& id : _bvh->get_leaf_primitives(i)) {
+            // triangle of the mesh
+            if (id < n_mesh) {
+                TriangleUV uv = { { mesh.texcoord(id, 0), mesh.texcoord(id, 1), mesh.texcoord(id, 2) }, 0.0f };
+                _triangles.push_back(mesh.vertex(id, 0), mesh.vertex(id, 1), mesh.vertex(id, 2), mesh.material(id), uv);
+                continue;
+            }
+            // other object
+            const Boundable* obj = objects[id - n_mesh];
             if (const Triangle* t = dynamic_cast<const Triangle*>(obj)) {
-                tris->push_back(*t);
+                _triangles.push_back(*t);
             } else if (const Sphere* s = dynamic_cast<const Sphere*>(obj)) {
-                spheres->push_back(*s);
+                _spheres.push_back(*s);
             }
         }
-        // create a primitive list holding all collections
-        PrimitiveList* collections = new PrimitiveList; 
-        // push all non-empty collections
-        if (tris->n_primitives() > 0) { collections->push_back(tris); }
-        if (spheres->n_primitives() > 0) { collections->push_back(spheres); }
-        // push the collections to the primitive list of the scene
-        _primitives.push_back(collections);
+        // make sure the next leaf
+        // starts new packets
+        _triangles.close_packet();
+        _spheres.close_packet();
+        leaf.tri_end = _triangles.n_packets();
+        leaf.sph_end = _spheres.n_packets();
+        _leafs.push_back(leaf);
     }
 }
 
-Scene::Scene(const BoundableList& objects)
+Scene::Scene(Arena&& arena) :
+    _arena(std::move(arena))
+{
+}
+
+Scene::Scene(const BoundableList& objects, const TriangleKernel& kernel)
 {
     // initialize scene from the given
     // list of objects
-    init(objects);
+    init(Mesh(), objects, kernel);
+}
+
+Scene::Scene(const Mesh& mesh, const TriangleKernel& kernel)
+{
+    // initialize the scene from the
+    // triangles of the mesh only
+    init(mesh, BoundableList(), kernel);
+}
+
+Scene::Scene(const Mesh& mesh, const BoundableList& objects, const TriangleKernel& kernel)
+{
+    // initialize the scene from the mesh
+    // and the additional objects
+    init(mesh, objects, kernel);
 }
 
-Scene::Scene(const Mesh& mesh)
+Scene::Scene(
+    const Mesh& mesh,
+    const BoundableList& objects,
+    Arena&& arena,
+    const TriangleKernel& kernel
+) :
+    _arena(std::move(arena))
 {
-    // convert the mesh to a list of boundables
-    BoundableList objs;
-    objs.insert(objs.begin(), mesh.begin(), mesh.end());
-    // initialize the scene from the objects
-    init(objs);
+    // initialize the scene from the mesh
+    // and the objects owned by the arena
+    init(mesh, objects, kernel);
 }
 
 Scene::~Scene(void)
 {
-    // delete primitives
-    for (Primitive* p : _primitives) { delete p; }
+    // everything else is released by the arena
+    if (_snapshot != nullptr) { munmap((void*)_snapshot, _snapshot_size); }
+}
+
+void Scene::surface(
+    const Hit& hit,
+    const Vec3f& origin,
+    const Vec3f& direction,
+    HitRecord& record
+) const {
+    // let the collection holding the
+    // primitive rebuild the hit record
+    switch (hit.type) {
+        case PrimitiveType::Triangle:
+            _triangles.surface(hit, origin, direction, record);
+            break;
+        case PrimitiveType::Sphere:
+            _spheres.surface(hit, origin, direction, record);
+            break;
+        default:
+            break;
+    }
+}
+
+const mtl::Material* Scene::material(const Hit& hit) const {
+    switch (hit.type) {
+        case PrimitiveType::Triangle: return _triangles.material(hit);
+        case PrimitiveType::Sphere: return _spheres.material(hit);
+        default: return nullptr;
+    }
+}
+
+void Scene::replicate(const Scene& other) {
+    // copy the tree and the packets, copies of
+    // views still refer to the memory of the
+    // other scene until they own their elements
+    _bvh = _arena.create<BVH>(*other._bvh);
+    _bvh->tree.own();
+    _leafs = other._leafs;
+    _leafs.own();
+    _triangles = other._triangles;
+    for (Buffer<std::array<Vec4f, 3>>* b : { &_triangles.As, &_triangles.Us, &_triangles.Vs, &_triangles.Bs, &_triangles.Cs }) { b->own(); }
+    _triangles.planes.own();
+    _triangles.Ns.own();
+    _triangles.UVs.own();
+    _triangles.mtl_ids.own();
+    _spheres = other._spheres;
+    _spheres.centers.own();
+    _spheres.radii.own();
+    _spheres.mtl_ids.own();
+}
+
+size_t Scene::n_bytes(void) const {
+    // sum up the sizes of all arrays
+    auto bytes = [](const auto& b) { return b.size() * sizeof(*b.data()); };
+    size_t n = bytes(_bvh->tree) + bytes(_leafs);
+    n += bytes(_triangles.As) + bytes(_triangles.Us) + bytes(_triangles.Vs) + bytes(_triangles.Bs) + bytes(_triangles.Cs);
+    n += bytes(_triangles.planes) + bytes(_triangles.Ns) + bytes(_triangles.UVs) + bytes(_triangles.mtl_ids);
+    n += bytes(_spheres.centers) + bytes(_spheres.radii) + bytes(_spheres.mtl_ids);
+    return n;
 }
 
 // getter functions
 const BVH& Scene::bvh(void) const { return *_bvh; }
-const PrimitiveList& Scene::primitives(void) const { return _primitives; }
+const Arena& Scene::arena(void) const { return _arena; }
+const TriangleKernel& Scene::triangle_kernel(void) const { return _triangles.kernel(); }
+
+/*
+ *  Snapshot
+ */
+
+// the arrays stored in a snapshot
+enum SnapshotArray {
+    SnapshotNodes,
+    SnapshotLeafs,
+    SnapshotTriangleA,
+    SnapshotTriangleU,
+    SnapshotTriangleV,
+    SnapshotTriangleB,
+    SnapshotTriangleC,
+    SnapshotTrianglePlanes,
+    SnapshotTriangleNormals,
+    SnapshotTriangleTexCoords,
+    SnapshotTriangleMaterials,
+    SnapshotSphereCenters,
+    SnapshotSphereRadii,
+    SnapshotSphereMaterials,
+    n_snapshot_arrays
+};
+
+// the size of a single element of each array
+const size_t snapshot_element_size[n_snapshot_arrays] = {
+    sizeof(BVHNode),
+    sizeof(SceneLeaf),
+    sizeof(std::array<Vec4f, 3>),
+    sizeof(std::array<Vec4f, 3>),
+    sizeof(std::array<Vec4f, 3>),
+    sizeof(std::array<Vec4f, 3>),
+    sizeof(std::array<Vec4f, 3>),
+    sizeof(std::array<Vec4f, 12>),
+    sizeof(Vec3f),
+    sizeof(TriangleUV),
+    sizeof(uint32_t),
+    sizeof(std::array<Vec4f, 3>),
+    sizeof(Vec4f),
+    sizeof(uint32_t)
+};
+
+// all arrays are referred to by their offset from the
+// start of the file such that the file can be mapped
+// anywhere and used without any fixups
+typedef struct SceneSnapshotHeader {
+    char magic[8];              // "FAIRSCNE"
+    uint32_t version;           // format version
+    uint32_t kernel;            // triangle kernel of the packets
+    uint32_t n_materials;       // size of the material table
+    uint32_t n_leafs;           // number of leafs of the bvh
+    uint64_t n_triangles;       // triangle lanes including padding
+    uint64_t n_spheres;         // sphere lanes including padding
+    float bounds[6];            // lower and upper corner of the scene
+    uint64_t offsets[n_snapshot_arrays];
+    uint64_t counts[n_snapshot_arrays];
+    uint64_t size;              // size of the whole file
+} SceneSnapshotHeader;
+
+const char snapshot_magic[8] = { 'F', 'A', 'I', 'R', 'S', 'C', 'N', 'E' };
+const uint32_t snapshot_version = 2;
+
+// round up to the alignment of the arrays
+inline uint64_t snapshot_align(const uint64_t& n) { return (n + 63) & ~(uint64_t)63; }
+
+// translate the material ids of a collection from its
+// own material table into the ids of the given table
+static bool translate_materials(
+    const Buffer<uint32_t>& ids,
+    const std::vector<const mtl::Material*>& own,
+    const std::vector<const mtl::Material*>& table,
+    std::vector<uint32_t>& result
+) {
+    std::vector<uint32_t> remap(own.size());
+    for (size_t k = 0; k < own.size(); k++) {
+        auto it = std::find(table.begin(), table.end(), own[k]);
+        if (it == table.end()) { return false; }
+        remap[k] = it - table.begin();
+    }
+    result.resize(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) { result[i] = remap[ids[i]]; }
+    return true;
+}
+
+bool Scene::save_snapshot(
+    const char* fpath,
+    const std::vector<const mtl::Material*>& materials
+) const {
+    // nothing to store
+    if (_bvh == nullptr) { return false; }
+    // the material ids are written
+    // with respect to the given table
+    std::vector<uint32_t> tri_mtls, sph_mtls;
+    if (!translate_materials(_triangles.mtl_ids, _triangles.materials, materials, tri_mtls)
+        || !translate_materials(_spheres.mtl_ids, _spheres.materials, materials, sph_mtls)) {
+        return false;
+    }
+    // the memory and the number of
+    // elements of all arrays
+    const void* data[n_snapshot_arrays] = {
+        _bvh->tree.data(), _leafs.data(),
+        _triangles.As.data(), _triangles.Us.data(), _triangles.Vs.data(),
+        _triangles.Bs.data(), _triangles.Cs.data(), _triangles.planes.data(),
+        _triangles.Ns.data(), _triangles.UVs.data(), tri_mtls.data(),
+        _spheres.centers.data(), _spheres.radii.data(), sph_mtls.data()
+    };
+    const size_t counts[n_snapshot_arrays] = {
+        _bvh->tree.size(), _leafs.size(),
+        _triangles.As.size(), _triangles.Us.size(), _triangles.Vs.size(),
+        _triangles.Bs.size(), _triangles.Cs.size(), _triangles.planes.size(),
+        _triangles.Ns.size(), _triangles.UVs.size(), tri_mtls.size(),
+        _spheres.centers.size(), _spheres.radii.size(), sph_mtls.size()
+    };
+    // build the header and place the arrays
+    // one after the other behind it
+    SceneSnapshotHeader header;
+    std::fill((char*)&header, (char*)&header + sizeof(SceneSnapshotHeader), 0);
+    std::copy(snapshot_magic, snapshot_magic + 8, header.magic);
+    header.version = snapshot_version;
+    header.kernel = (uint32_t)_triangles.kernel();
+    header.n_materials = materials.size();
+    header.n_leafs = _bvh->num_leafs();
+    header.n_triangles = _triangles.n_primitives();
+    header.n_spheres = _spheres.n_primitives();
+    for (size_t k = 0; k < 3; k++) {
+        header.bounds[k] = _bvh->bounds().lower()[k];
+        header.bounds[k + 3] = _bvh->bounds().upper()[k];
+    }
+    uint64_t offset = sizeof(SceneSnapshotHeader);
+    for (size_t a = 0; a < n_snapshot_arrays; a++) {
+        header.offsets[a] = snapshot_align(offset);
+        header.counts[a] = counts[a];
+        offset = header.offsets[a] + counts[a] * snapshot_element_size[a];
+    }
+    header.size = offset;
+    // write the header and the arrays at their offsets
+    FILE* f = fopen(fpath, "wb");
+    if (f == nullptr) { return false; }
+    auto write_at = [f](const uint64_t& offset, const void* data, const size_t& n) {
+        return (n == 0) || ((fseek(f, offset, SEEK_SET) == 0) && (fwrite(data, 1, n, f) == n));
+    };
+    bool ok = write_at(0, &header, sizeof(SceneSnapshotHeader));
+    for (size_t a = 0; a < n_snapshot_arrays; a++) {
+        ok = ok && write_at(header.offsets[a], data[a], counts[a] * snapshot_element_size[a]);
+    }
+    return (fclose(f) == 0) && ok;
+}
+
+bool Scene::load_snapshot(
+    const char* fpath,
+    const std::vector<const mtl::Material*>& materials
+) {
+    // map the whole file into memory, the mapping is
+    // shared such that all processes loading the same
+    // snapshot use the same physical pages
+    int fd = open(fpath, O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(SceneSnapshotHeader))) { close(fd); return false; }
+    size_t size = st.st_size;
+    const char* data = (const char*)mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) { return false; }
+    // make sure the header belongs to a complete
+    // snapshot of the current version and that all
+    // arrays are aligned and inside of the file
+    const SceneSnapshotHeader& header = *(const SceneSnapshotHeader*)data;
+    const uint64_t* counts = header.counts;
+    size_t n_tri_packets = header.n_triangles / 4, n_sph_packets = header.n_spheres / 4;
+    bool valid = std::equal(snapshot_magic, snapshot_magic + 8, header.magic)
+        && (header.version == snapshot_version)
+        && (header.size == size)
+        && (header.kernel <= (uint32_t)TriangleKernel::Plane)
+        && (header.n_materials <= materials.size())
+        && (header.n_triangles % 4 == 0)
+        && (header.n_spheres % 4 == 0);
+    for (size_t a = 0; valid && (a < n_snapshot_arrays); a++) {
+        valid = (header.offsets[a] % 64 == 0)
+            && (header.offsets[a] >= sizeof(SceneSnapshotHeader))
+            && (header.offsets[a] <= size)
+            && (counts[a] <= (size - header.offsets[a]) / snapshot_element_size[a]);
+    }
+    // the arrays need to match the number of
+    // primitives and the triangle kernel
+    TriangleKernel kernel = (TriangleKernel)header.kernel;
+    bool mt = (kernel == TriangleKernel::MollerTrumbore);
+    bool wt = (kernel == TriangleKernel::Watertight);
+    bool pl = (kernel == TriangleKernel::Plane);
+    valid = valid
+        && (counts[SnapshotNodes] > 0)
+        && (counts[SnapshotLeafs] == header.n_leafs)
+        && (counts[SnapshotTriangleA] == ((mt || wt)? n_tri_packets : 0))
+        && (counts[SnapshotTriangleU] == (mt? n_tri_packets : 0))
+        && (counts[SnapshotTriangleV] == (mt? n_tri_packets : 0))
+        && (counts[SnapshotTriangleB] == (wt? n_tri_packets : 0))
+        && (counts[SnapshotTriangleC] == (wt? n_tri_packets : 0))
+        && (counts[SnapshotTrianglePlanes] == (pl? n_tri_packets : 0))
+        && (counts[SnapshotTriangleNormals] == header.n_triangles)
+        && (counts[SnapshotTriangleTexCoords] == header.n_triangles)
+        && (counts[SnapshotTriangleMaterials] == header.n_triangles)
+        && (counts[SnapshotSphereCenters] == n_sph_packets)
+        && (counts[SnapshotSphereRadii] == n_sph_packets)
+        && (counts[SnapshotSphereMaterials] == header.n_spheres);
+    // get the typed arrays
+    auto array = [data, &header](const SnapshotArray& a) { return data + header.offsets[a]; };
+    const BVHNode* nodes = (const BVHNode*)array(SnapshotNodes);
+    const SceneLeaf* leafs = (const SceneLeaf*)array(SnapshotLeafs);
+    const uint32_t* tri_mtls = (const uint32_t*)array(SnapshotTriangleMaterials);
+    const uint32_t* sph_mtls = (const uint32_t*)array(SnapshotSphereMaterials);
+    // reject references that are out of range
+    // as the tree is traversed without checks
+    size_t n_nodes = valid? counts[SnapshotNodes] : 0;
+    for (size_t i = 0; valid && (i < n_nodes); i++) {
+        const BVHNode& node = nodes[i];
+        valid = node.is_leaf?
+            ((node.leaf_id < header.n_leafs) || (node.leaf_id == (uint32_t)-1)) :
+            ((node.child > i) && ((uint64_t)node.child + 4 <= n_nodes));
+    }
+    for (size_t i = 0; valid && (i < header.n_leafs); i++) {
+        const SceneLeaf& leaf = leafs[i];
+        valid = (leaf.tri_begin <= leaf.tri_end) && (leaf.tri_end <= n_tri_packets)
+            && (leaf.sph_begin <= leaf.sph_end) && (leaf.sph_end <= n_sph_packets);
+    }
+    auto known = [&header](const uint32_t& id) { return id < header.n_materials; };
+    valid = valid
+        && std::all_of(tri_mtls, tri_mtls + (valid? header.n_triangles : 0), known)
+        && std::all_of(sph_mtls, sph_mtls + (valid? header.n_spheres : 0), known);
+    if (!valid) {
+        munmap((void*)data, size);
+        return false;
+    }
+    // release a previously loaded snapshot, note that a tree
+    // built before stays in the arena until it is cleared
+    if (_snapshot != nullptr) { munmap((void*)_snapshot, _snapshot_size); }
+    _snapshot = data;
+    _snapshot_size = size;
+    // let the tree, the leafs and the packets
+    // refer to the arrays in the mapped file
+    AABB bounds(
+        Vec3f(header.bounds[0], header.bounds[1], header.bounds[2]),
+        Vec3f(header.bounds[3], header.bounds[4], header.bounds[5])
+    );
+    _bvh = _arena.create<BVH>(nodes, n_nodes, header.n_leafs, bounds);
+    _leafs.view(leafs, header.n_leafs);
+    _triangles = TriangleCollection(kernel);
+    _triangles.As.view((const std::array<Vec4f, 3>*)array(SnapshotTriangleA), counts[SnapshotTriangleA]);
+    _triangles.Us.view((const std::array<Vec4f, 3>*)array(SnapshotTriangleU), counts[SnapshotTriangleU]);
+    _triangles.Vs.view((const std::array<Vec4f, 3>*)array(SnapshotTriangleV), counts[SnapshotTriangleV]);
+    _triangles.Bs.view((const std::array<Vec4f, 3>*)array(SnapshotTriangleB), counts[SnapshotTriangleB]);
+    _triangles.Cs.view((const std::array<Vec4f, 3>*)array(SnapshotTriangleC), counts[SnapshotTriangleC]);
+    _triangles.planes.view((const std::array<Vec4f, 12>*)array(SnapshotTrianglePlanes), counts[SnapshotTrianglePlanes]);
+    _triangles.Ns.view((const Vec3f*)array(SnapshotTriangleNormals), header.n_triangles);
+    _triangles.UVs.view((const TriangleUV*)array(SnapshotTriangleTexCoords), header.n_triangles);
+    _triangles.mtl_ids.view(tri_mtls, header.n_triangles);
+    _triangles.materials = materials;
+    _triangles.n_triangles = header.n_triangles;
+    _spheres = SphereCollection();
+    _spheres.centers.view((const std::array<Vec4f, 3>*)array(SnapshotSphereCenters), n_sph_packets);
+    _spheres.radii.view((const Vec4f*)array(SnapshotSphereRadii), n_sph_packets);
+    _spheres.mtl_ids.view(sph_mtls, header.n_spheres);
+    _spheres.materials = materials;
+    _spheres.n_spheres = header.n_spheres;
+    return true;
+}
@@ -3,29 +3,133 @@
 
 // includes
 #include <vector>
+#include <cstdint>
 #include "./bvh.hpp"
+#include "./arena.hpp"
+#include "./buffer.hpp"
 #include "./mesh.hpp"
 #include "./primitive.hpp"
 
+// ranges of the primitive packets
+// assigned to a leaf of the bvh
+typedef struct SceneLeaf {
+    uint32_t tri_begin, tri_end;
+    uint32_t sph_begin, sph_end;
+} SceneLeaf;
+
 class Scene {
 private:
+    // arena owning the objects of the scene, i.e. the
+    // primitives, materials and textures created in it
+    // as well as the bounding volume hierarchy
+    Arena _arena;
     // the bounding volume hierarchy
     // organizing all boundables in the scene
-    BVH* _bvh;
-    // the actual primitives
-    // note that each primitive corresponds
-    // to exactly one leaf node of the bvh
-    PrimitiveList _primitives;
-    // private method to initialize scene a scene
-    void init(const BoundableList& objects);    
+    BVH* _bvh = nullptr;
+    // flat packet arrays holding the
+    // primitives of all leafs
+    TriangleCollection _triangles;
+    SphereCollection _spheres;
+    // the packet ranges of each
+    // leaf node of the bvh
+    Buffer<SceneLeaf> _leafs;
+    // the memory mapped snapshot the tree, the leafs
+    // and the packets refer to if the scene was loaded
+    const char* _snapshot = nullptr;
+    size_t _snapshot_size = 0;
+    // private method to initialize a scene from the
+    // triangles of a mesh and a list of other objects
+    void init(
+        const Mesh& mesh,
+        const BoundableList& objects,
+        const TriangleKernel& kernel
+    );
 public:
-    // constructors / destructor
-    Scene(const BoundableList& objects);
-    Scene(const Mesh& mesh);
+    // constructors / destructor, the
+    // empty scene is meant to load a snapshot
+    Scene(void) = default;
+    Scene(Arena&& arena);
+    Scene(const BoundableList& objects, const TriangleKernel& kernel = TriangleKernel::MollerTrumbore);
+    Scene(const Mesh& mesh, const TriangleKernel& kernel = TriangleKernel::MollerTrumbore);
+    Scene(const Mesh& mesh, const BoundableList& objects, const TriangleKernel& kernel = TriangleKernel::MollerTrumbore);
+    // the scene takes over the arena in which the objects
+    // were created and releases them when it is destroyed
+    Scene(const Mesh& mesh, const BoundableList& objects, Arena&& arena, const TriangleKernel& kernel = TriangleKernel::MollerTrumbore);
     ~Scene(void);
     // getters
     const BVH& bvh(void) const;
-    const PrimitiveList& primitives(void) const;
+    const Arena& arena(void) const;
+    const TriangleKernel& triangle_kernel(void) const;
+    // the snapshot holds the tree, the leaf ranges and the
+    // packets as they are stored in memory, the materials are
+    // stored as ids into the given table which has to contain
+    // all materials of the scene and which is passed again
+    // when loading the snapshot, the file is mapped read-only
+    // and shared by all processes loading it
+    bool save_snapshot(
+        const char* fpath,
+        const std::vector<const mtl::Material*>& materials
+    ) const;
+    bool load_snapshot(
+        const char* fpath,
+        const std::vector<const mtl::Material*>& materials
+    );
+    // make the empty scene a replica of the given one, the
+    // tree, the leaf ranges and the packets are copied into
+    // memory owned by the replica, which is placed near the
+    // calling thread, the materials and textures are shared
+    void replicate(const Scene& other);
+    // the number of bytes of the tree, the leaf
+    // ranges and the packets of the scene
+    size_t n_bytes(void) const;
+    // cast a ray against all primitives
+    // of the leaf with the given id
+    inline bool cast(
+        const Ray4& ray,
+        const size_t& leaf_id,
+        Hit& hit
+    ) const;
+    // hint the caches to load the packet ranges of a leaf
+    // and the first packets of a leaf, the latter reads the
+    // ranges such that they should have been prefetched
+    // well before, the packets of a leaf are contiguous
+    // and thus the following ones are loaded anyway
+    inline void prefetch_leaf(const size_t& leaf_id) const;
+    inline void prefetch_packets(const size_t& leaf_id) const;
+    // reconstruct the full hit record
+    // of the given hit
+    void surface(
+        const Hit& hit,
+        const Vec3f& origin,
+        const Vec3f& direction,
+        HitRecord& record
+    ) const;
+    // the material of the primitive of the given hit
+    const mtl::Material* material(const Hit& hit) const;
 };
 
+inline bool Scene::cast(
+    const Ray4& ray,
+    const size_t& leaf_id,
+    Hit& hit
+) const {
+    // cast the ray against the triangle and
+    // sphere packets of the leaf, each of them
+    // updates the hit if it is closer
+    const SceneLeaf& leaf = _leafs[leaf_id];
+    bool is_closer = _triangles.cast(ray, leaf.tri_begin, leaf.tri_end, hit);
+    is_closer |= cast_packets(_spheres, ray, leaf.sph_begin, leaf.sph_end, hit);
+    return is_closer;
+}
+
+inline void Scene::prefetch_leaf(const size_t& leaf_id) const {
+    _leafs.prefetch(leaf_id);
+}
+
+inline void Scene::prefetch_packets(const size_t& leaf_id) const {
+    const SceneLeaf& leaf = _leafs[leaf_id];
+    if (leaf.tri_begin < leaf.tri_end) { _triangles.prefetch(leaf.tri_begin); }
+    if (leaf.sph_begin < leaf.sph_end) { _spheres.prefetch(leaf.sph_begin); }
+}
+
 #endif // H_SCENE
@@ -1,13 +1,55 @@
 #include "./texture.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 
 // use texture namespace
 using namespace txr;
 
+/*
+ *  Texture
+ */
+
+Vec3f Texture::sample(
+    const Vec3f& p,
+    const TexCoord& uv,
+    const float& width
+) const {
+    // ignore the texture coordinates
+    return color(p);
+}
+
+void Texture::color(
+    const float* px,
+    const float* py,
+    const float* pz,
+    const size_t& n,
+    Vec3f* out
+) const {
+    // evaluate one point after the other
+    for (size_t i = 0; i < n; i++) { out[i] = color(Vec3f(px[i], py[i], pz[i])); }
+}
+
+void Texture::sample(
+    const float* px,
+    const float* py,
+    const float* pz,
+    const TexCoord* uvs,
+    const float* widths,
+    const size_t& n,
+    Vec3f* out
+) const {
+    // ignore the texture coordinates
+    color(px, py, pz, n, out);
+}
+
+
 /*
  *  Constant Texture
  */
 
-Constant::Constant(const Vec3f& color) : 
+Constant::Constant(const Vec3f& color) :
     c(color) {}
 
 Vec3f Constant::color(const Vec3f& p) const {
@@ -16,3 +58,607 @@ Vec3f Constant::color(const Vec3f& p) const {
     return c;
 }
 
+void Constant::color(
+    const float* px,
+    const float* py,
+    const float* pz,
+    const size_t& n,
+    Vec3f* out
+) const {
+    std::fill(out, out + n, c);
+}
+
+
+/*
+ *  Procedural Textures
+ */
+
+// load the coordinates of up to eight points, the
+// missing points of the last batch are zero
+inline Vec8f load8(const float* p, const size_t& n) {
+    if (n >= 8) { return _mm256_loadu_ps(p); }
+    alignas(32) float tmp[8] = { 0.0f };
+    std::copy(p, p + n, tmp);
+    return _mm256_load_ps(tmp);
+}
+
+// blend between two colors by the given weights and
+// write the colors of the first n of the eight points
+inline void store8(
+    const Vec3f& a,
+    const Vec3f& b,
+    const Vec8f& t,
+    const size_t& n,
+    Vec3f* out
+) {
+    alignas(32) float c[3][8];
+    for (size_t k = 0; k < 3; k++) {
+        _mm256_store_ps(c[k], t.fmadd(Vec8f(b[k] - a[k]), Vec8f(a[k])));
+    }
+    for (size_t i = 0; (i < n) && (i < 8); i++) { out[i] = Vec3f(c[0][i], c[1][i], c[2][i]); }
+}
+
+Checker::Checker(
+    const Vec3f& a,
+    const Vec3f& b,
+    const float& size
+) :
+    a(a), b(b), inv_size(1.0f / size) {}
+
+Vec3f Checker::color(const Vec3f& p) const {
+    Vec3f c;
+    Checker::color(&p[0], &p[1], &p[2], 1, &c);
+    return c;
+}
+
+void Checker::color(
+    const float* px,
+    const float* py,
+    const float* pz,
+    const size_t& n,
+    Vec3f* out
+) const {
+    Vec8f s(inv_size);
+    for (size_t i = 0; i < n; i += 8) {
+        // the parity of the sum of the cell
+        // indices picks the color
+        __m256i ix = _mm256_cvttps_epi32(_mm256_floor_ps(load8(px + i, n - i) * s));
+        __m256i iy = _mm256_cvttps_epi32(_mm256_floor_ps(load8(py + i, n - i) * s));
+        __m256i iz = _mm256_cvttps_epi32(_mm256_floor_ps(load8(pz + i, n - i) * s));
+        __m256i odd = _mm256_and_si256(_mm256_add_epi32(_mm256_add_epi32(ix, iy), iz), _mm256_set1_epi32(1));
+        store8(a, b, _mm256_cvtepi32_ps(odd), n - i, out + i);
+    }
+}
+
+// hash of the integer lattice points
+inline __m256i hash8(const __m256i& x, const __m256i& y, const __m256i& z) {
+    __m256i h = _mm256_xor_si256(
+        _mm256_xor_si256(_mm256_mullo_epi32(x, _mm256_set1_epi32(0x8da6b343)), _mm256_mullo_epi32(y, _mm256_set1_epi32(0xd8163841))),
+        _mm256_mullo_epi32(z, _mm256_set1_epi32(0xcb1ab31f))
+    );
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x2c1b3c6d));
+    return _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+}
+
+// dot product of the offset to a lattice point with one
+// of the twelve edge directions of a cube picked by the
+// hash as in the improved noise of perlin
+inline Vec8f grad8(const __m256i& hash, const Vec8f& x, const Vec8f& y, const Vec8f& z) {
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+    Vec8f lt8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    Vec8f lt4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    Vec8f is_x = _mm256_castsi256_ps(_mm256_or_si256(
+        _mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)), _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))
+    ));
+    Vec8f u = y.take(x, lt8);
+    Vec8f v = z.take(x, is_x).take(y, lt4);
+    // the lowest two bits flip the signs
+    Vec8f su = _mm256_castsi256_ps(_mm256_slli_epi32(h, 31));
+    Vec8f sv = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(h, 1), 31));
+    return _mm256_xor_ps(u, su) + _mm256_xor_ps(v, sv);
+}
+
+// smooth step of the improved noise
+inline Vec8f fade8(const Vec8f& t) {
+    return t * t * t * t.fmadd(t.fmadd(Vec8f(6.0f), Vec8f(-15.0f)), Vec8f(10.0f));
+}
+
+inline Vec8f lerp8(const Vec8f& t, const Vec8f& a, const Vec8f& b) {
+    return t.fmadd(b - a, a);
+}
+
+// gradient noise in about [-1, 1] at eight points
+inline Vec8f noise8(const Vec8f& x, const Vec8f& y, const Vec8f& z) {
+    // the lattice cell and the position within
+    Vec8f fx = _mm256_floor_ps(x), fy = _mm256_floor_ps(y), fz = _mm256_floor_ps(z);
+    __m256i ix = _mm256_cvttps_epi32(fx), iy = _mm256_cvttps_epi32(fy), iz = _mm256_cvttps_epi32(fz);
+    Vec8f dx = x - fx, dy = y - fy, dz = z - fz;
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i jx = _mm256_add_epi32(ix, one), jy = _mm256_add_epi32(iy, one), jz = _mm256_add_epi32(iz, one);
+    Vec8f ex = dx - Vec8f::ones, ey = dy - Vec8f::ones, ez = dz - Vec8f::ones;
+    // blend the gradients of the eight corners
+    Vec8f u = fade8(dx), v = fade8(dy), w = fade8(dz);
+    Vec8f x00 = lerp8(u, grad8(hash8(ix, iy, iz), dx, dy, dz), grad8(hash8(jx, iy, iz), ex, dy, dz));
+    Vec8f x10 = lerp8(u, grad8(hash8(ix, jy, iz), dx, ey, dz), grad8(hash8(jx, jy, iz), ex, ey, dz));
+    Vec8f x01 = lerp8(u, grad8(hash8(ix, iy, jz), dx, dy, ez), grad8(hash8(jx, iy, jz), ex, dy, ez));
+    Vec8f x11 = lerp8(u, grad8(hash8(ix, jy, jz), dx, ey, ez), grad8(hash8(jx, jy, jz), ex, ey, ez));
+    return lerp8(w, lerp8(v, x00, x10), lerp8(v, x01, x11));
+}
+
+Noise::Noise(
+    const Vec3f& a,
+    const Vec3f& b,
+    const float& frequency,
+    const size_t& octaves
+) :
+    a(a), b(b), frequency(frequency), octaves(std::max<size_t>(1, octaves)) {}
+
+Vec3f Noise::color(const Vec3f& p) const {
+    Vec3f c;
+    Noise::color(&p[0], &p[1], &p[2], 1, &c);
+    return c;
+}
+
+void Noise::color(
+    const float* px,
+    const float* py,
+    const float* pz,
+    const size_t& n,
+    Vec3f* out
+) const {
+    for (size_t i = 0; i < n; i += 8) {
+        Vec8f x = load8(px + i, n - i), y = load8(py + i, n - i), z = load8(pz + i, n - i);
+        // sum up the octaves
+        Vec8f sum = Vec8f::zeros;
+        float f = frequency, amp = 1.0f, total = 0.0f;
+        for (size_t o = 0; o < octaves; o++) {
+            Vec8f s(f);
+            sum = Vec8f(amp).fmadd(noise8(x * s, y * s, z * s), sum);
+            total += amp;
+            f *= 2.0f;
+            amp *= 0.5f;
+        }
+        // map the noise to the blend weight
+        Vec8f t = (sum * Vec8f(0.5f / total) + Vec8f(0.5f)).max(Vec8f::zeros).min(Vec8f::ones);
+        store8(a, b, t, n - i, out + i);
+    }
+}
+
+Gradient::Gradient(
+    const Vec3f& a,
+    const Vec3f& b,
+    const Vec3f& start,
+    const Vec3f& end
+) :
+    a(a), b(b), start(start)
+{
+    Vec3f d = end - start;
+    float sq = d.sq_norm()[0];
+    dir = (sq > 0.0f)? Vec3f(d / sq) : Vec3f::zeros;
+}
+
+Vec3f Gradient::color(const Vec3f& p) const {
+    Vec3f c;
+    Gradient::color(&p[0], &p[1], &p[2], 1, &c);
+    return c;
+}
+
+void Gradient::color(
+    const float* px,
+    const float* py,
+    const float* pz,
+    const size_t& n,
+    Vec3f* out
+) const {
+    for (size_t i = 0; i < n; i += 8) {
+        // project the offsets to the start point
+        // onto the scaled direction
+        Vec8f t = (load8(px + i, n - i) - Vec8f(start[0])) * Vec8f(dir[0]);
+        t = (load8(py + i, n - i) - Vec8f(start[1])).fmadd(Vec8f(dir[1]), t);
+        t = (load8(pz + i, n - i) - Vec8f(start[2])).fmadd(Vec8f(dir[2]), t);
+        store8(a, b, t.max(Vec8f::zeros).min(Vec8f::ones), n - i, out + i);
+    }
+}
+
+
+/*
+ *  Image Texture
+ */
+
+// the texels are stored in display gamma, which the
+// renderer approximates by a square root, and are
+// converted to linear values before filtering
+inline float decode(const uint32_t& texel, const size_t& k) {
+    float c = ((texel >> (8 * k)) & 255u) / 255.0f;
+    return c * c;
+}
+
+inline uint32_t encode(const float& r, const float& g, const float& b) {
+    auto channel = [](const float& c) {
+        return (uint32_t)(sqrtf(std::min(std::max(c, 0.0f), 1.0f)) * 255.0f + 0.5f);
+    };
+    return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (255u << 24);
+}
+
+// the four texels around the texture coordinates
+// and the weights of the right and the lower ones
+typedef struct BilinearTexels {
+    size_t x0, x1, y0, y1;
+    float tx, ty;
+} BilinearTexels;
+
+inline BilinearTexels bilinear_texels(
+    const size_t& w,
+    const size_t& h,
+    const TexCoord& uv
+) {
+    // wrap the coordinates into the unit square, the texel
+    // centers are at half-integer positions and the four
+    // texels around the position wrap around the borders
+    float fx = (uv.u - floorf(uv.u)) * w - 0.5f;
+    float fy = (uv.v - floorf(uv.v)) * h - 0.5f;
+    float x_floor = floorf(fx), y_floor = floorf(fy);
+    BilinearTexels b;
+    b.tx = fx - x_floor;
+    b.ty = fy - y_floor;
+    b.x0 = (x_floor < 0.0f)? w - 1 : std::min((size_t)x_floor, w - 1);
+    b.y0 = (y_floor < 0.0f)? h - 1 : std::min((size_t)y_floor, h - 1);
+    b.x1 = (b.x0 + 1 == w)? 0 : b.x0 + 1;
+    b.y1 = (b.y0 + 1 == h)? 0 : b.y0 + 1;
+    return b;
+}
+
+// blend the texels (x0, y0), (x1, y0), (x0, y1) and (x1, y1)
+inline Vec3f bilinear_blend(
+    const uint32_t* texels,
+    const float& tx,
+    const float& ty
+) {
+    // unpack two texels per register, square them to get
+    // linear values and blend them by their weights
+    __m128i t = _mm_loadu_si128((const __m128i*)texels);
+    __m256 top = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(t));
+    __m256 bottom = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_unpackhi_epi64(t, t)));
+    __m256 w_top = _mm256_setr_m128(_mm_set1_ps((1.0f - tx) * (1.0f - ty)), _mm_set1_ps(tx * (1.0f - ty)));
+    __m256 w_bottom = _mm256_setr_m128(_mm_set1_ps((1.0f - tx) * ty), _mm_set1_ps(tx * ty));
+    __m256 c = _mm256_fmadd_ps(_mm256_mul_ps(top, top), w_top, _mm256_mul_ps(_mm256_mul_ps(bottom, bottom), w_bottom));
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(c), _mm256_extractf128_ps(c, 1));
+    return Vec3f(_mm_mul_ps(sum, _mm_set1_ps(1.0f / (255.0f * 255.0f))));
+}
+
+// blend the bilinear lookups in the two levels closest
+// to the level of detail at which a texel covers the
+// width of the footprint, levels beyond the last one
+// are clamped to the last level
+template<typename Lookup>
+inline Vec3f trilinear(
+    const size_t& size,
+    const size_t& n_levels,
+    const float& width,
+    const Lookup& bilinear_at
+) {
+    float n_texels = width * size;
+    float lod = (n_texels > 1.0f)? log2f(n_texels) : 0.0f;
+    size_t l = (size_t)lod;
+    if (l + 1 >= n_levels) { return bilinear_at(n_levels - 1); }
+    float f = lod - l;
+    Vec3f a = bilinear_at(l);
+    if (f == 0.0f) { return a; }
+    Vec3f b = bilinear_at(l + 1);
+    return Vec4f(f).fmadd(b - a, a);
+}
+
+// allocate the tiles of a level of the given size
+static MipLevel make_level(const size_t& width, const size_t& height) {
+    MipLevel level;
+    level.width = width;
+    level.height = height;
+    level.n_tiles_x = (width + 3) / 4;
+    level.tiles.resize(level.n_tiles_x * ((height + 3) / 4));
+    return level;
+}
+
+inline uint32_t Image::texel(
+    const MipLevel& level,
+    const size_t& x,
+    const size_t& y
+) const {
+    // find the tile and the texel within the tile
+    const ImageTile& tile = level.tiles[(y >> 2) * level.n_tiles_x + (x >> 2)];
+    return tile.texels[((y & 3) << 2) | (x & 3)];
+}
+
+Image::Image(
+    const size_t& width,
+    const size_t& height,
+    const uint8_t* rgb
+) {
+    if ((width == 0) || (height == 0)) { return; }
+    // copy the image into the tiles of the first level
+    levels.push_back(make_level(width, height));
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            const uint8_t* c = rgb + 3 * (y * width + x);
+            ImageTile& tile = levels[0].tiles[(y >> 2) * levels[0].n_tiles_x + (x >> 2)];
+            tile.texels[((y & 3) << 2) | (x & 3)] = c[0] | (c[1] << 8) | (c[2] << 16) | (255u << 24);
+        }
+    }
+    // halve the size of the image until it is a single
+    // texel, each texel averages a 2x2 block of the
+    // previous level in linear space
+    while ((levels.back().width > 1) || (levels.back().height > 1)) {
+        const MipLevel& prev = levels.back();
+        MipLevel level = make_level(std::max<size_t>(1, prev.width / 2), std::max<size_t>(1, prev.height / 2));
+        for (size_t y = 0; y < level.height; y++) {
+            for (size_t x = 0; x < level.width; x++) {
+                size_t x0 = 2 * x, x1 = std::min(x0 + 1, prev.width - 1);
+                size_t y0 = 2 * y, y1 = std::min(y0 + 1, prev.height - 1);
+                uint32_t t[4] = { texel(prev, x0, y0), texel(prev, x1, y0), texel(prev, x0, y1), texel(prev, x1, y1) };
+                float c[3] = { 0.0f, 0.0f, 0.0f };
+                for (size_t k = 0; k < 3; k++) {
+                    for (size_t i = 0; i < 4; i++) { c[k] += 0.25f * decode(t[i], k); }
+                }
+                ImageTile& tile = level.tiles[(y >> 2) * level.n_tiles_x + (x >> 2)];
+                tile.texels[((y & 3) << 2) | (x & 3)] = encode(c[0], c[1], c[2]);
+            }
+        }
+        levels.push_back(std::move(level));
+    }
+}
+
+Image Image::load_bmp(const char* fpath)
+{
+    FILE* f = fopen(fpath, "rb");
+    if (f == nullptr) { return Image(); }
+    // read the file and bitmap headers
+    uint8_t head[54];
+    if (fread(head, 1, 54, f) != 54) { fclose(f); return Image(); }
+    uint32_t offset, compression;
+    int32_t width, height;
+    uint16_t bpp;
+    memcpy(&offset, head + 10, 4);
+    memcpy(&width, head + 18, 4);
+    memcpy(&height, head + 22, 4);
+    memcpy(&bpp, head + 28, 2);
+    memcpy(&compression, head + 30, 4);
+    // only uncompressed 24 and 32 bit images, a
+    // negative height stores the rows from the top
+    if ((head[0] != 'B') || (head[1] != 'M') || (width <= 0) || (height == 0)
+        || ((bpp != 24) && (bpp != 32)) || (compression != 0)) {
+        fclose(f);
+        return Image();
+    }
+    bool top_down = (height < 0);
+    size_t w = width, h = top_down? -(int64_t)height : height;
+    // rows are padded to multiples of four bytes
+    size_t n_bytes = bpp / 8, row_size = (w * n_bytes + 3) & ~(size_t)3;
+    std::vector<uint8_t> row(row_size), rgb(3 * w * h);
+    bool ok = (fseek(f, offset, SEEK_SET) == 0);
+    for (size_t r = 0; ok && (r < h); r++) {
+        ok = (fread(row.data(), 1, row_size, f) == row_size);
+        // the pixels are stored as bgr(a)
+        uint8_t* out = rgb.data() + 3 * w * (top_down? r : h - 1 - r);
+        for (size_t x = 0; x < w; x++) {
+            out[3 * x + 0] = row[n_bytes * x + 2];
+            out[3 * x + 1] = row[n_bytes * x + 1];
+            out[3 * x + 2] = row[n_bytes * x + 0];
+        }
+    }
+    fclose(f);
+    return ok? Image(w, h, rgb.data()) : Image();
+}
+
+// header of a tiled image file filling the first block,
+// the levels are followed by the blocks of all levels
+const char tiled_magic[8] = { 'F', 'A', 'I', 'R', 'T', 'I', 'L', 'E' };
+const uint32_t tiled_version = 1;
+const size_t max_tiled_levels = 64;
+typedef struct TiledImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_levels;
+    TiledLevel levels[max_tiled_levels];
+} TiledImageHeader;
+// number of tiles along each side of a block
+const size_t block_tiles = 8;
+static_assert(sizeof(TiledImageHeader) <= cache_block_size, "tiled image header exceeds a block");
+static_assert(block_tiles * block_tiles * sizeof(ImageTile) == cache_block_size, "block is not filled by tiles");
+
+bool Image::save_tiled(const char* fpath) const {
+    if (levels.empty() || (levels.size() > max_tiled_levels)) { return false; }
+    // place the blocks of the levels one
+    // after the other behind the header
+    TiledImageHeader header;
+    std::fill((char*)&header, (char*)&header + sizeof(TiledImageHeader), 0);
+    std::copy(tiled_magic, tiled_magic + 8, header.magic);
+    header.version = tiled_version;
+    header.n_levels = levels.size();
+    uint64_t n_blocks = 1;
+    for (size_t l = 0; l < levels.size(); l++) {
+        TiledLevel& level = header.levels[l];
+        level.width = levels[l].width;
+        level.height = levels[l].height;
+        level.n_blocks_x = (levels[l].n_tiles_x + block_tiles - 1) / block_tiles;
+        level.first_block = n_blocks;
+        n_blocks += level.n_blocks_x * ((levels[l].height + 4 * block_tiles - 1) / (4 * block_tiles));
+    }
+    FILE* f = fopen(fpath, "wb");
+    if (f == nullptr) { return false; }
+    std::vector<ImageTile> block(block_tiles * block_tiles);
+    std::fill((char*)block.data(), (char*)block.data() + cache_block_size, 0);
+    memcpy(block.data(), &header, sizeof(TiledImageHeader));
+    bool ok = (fwrite(block.data(), 1, cache_block_size, f) == cache_block_size);
+    for (size_t l = 0; ok && (l < levels.size()); l++) {
+        const MipLevel& level = levels[l];
+        size_t n_tiles_y = level.tiles.size() / level.n_tiles_x;
+        size_t n_blocks_y = (n_tiles_y + block_tiles - 1) / block_tiles;
+        for (size_t by = 0; ok && (by < n_blocks_y); by++) {
+            for (size_t bx = 0; ok && (bx < header.levels[l].n_blocks_x); bx++) {
+                // gather the tiles of the block, the
+                // tiles outside of the level are zero
+                for (size_t ty = 0; ty < block_tiles; ty++) {
+                    for (size_t tx = 0; tx < block_tiles; tx++) {
+                        size_t x = bx * block_tiles + tx, y = by * block_tiles + ty;
+                        bool inside = (x < level.n_tiles_x) && (y < n_tiles_y);
+                        block[ty * block_tiles + tx] = inside? level.tiles[y * level.n_tiles_x + x] : ImageTile();
+                    }
+                }
+                ok = (fwrite(block.data(), 1, cache_block_size, f) == cache_block_size);
+            }
+        }
+    }
+    return (fclose(f) == 0) && ok;
+}
+
+size_t Image::width(void) const { return levels.empty()? 0 : levels[0].width; }
+size_t Image::height(void) const { return levels.empty()? 0 : levels[0].height; }
+size_t Image::n_levels(void) const { return levels.size(); }
+
+Vec3f Image::bilinear(
+    const MipLevel& level,
+    const TexCoord& uv
+) const {
+    BilinearTexels b = bilinear_texels(level.width, level.height, uv);
+    uint32_t t[4] = {
+        texel(level, b.x0, b.y0), texel(level, b.x1, b.y0),
+        texel(level, b.x0, b.y1), texel(level, b.x1, b.y1)
+    };
+    return bilinear_blend(t, b.tx, b.ty);
+}
+
+Vec3f Image::color(const Vec3f& p) const {
+    // the last level holds the average
+    if (levels.empty()) { return Vec3f::zeros; }
+    uint32_t t = levels.back().tiles[0].texels[0];
+    return Vec3f(decode(t, 0), decode(t, 1), decode(t, 2));
+}
+
+Vec3f Image::sample(
+    const Vec3f& p,
+    const TexCoord& uv,
+    const float& width
+) const {
+    if (levels.empty()) { return Vec3f::zeros; }
+    size_t size = std::max(levels[0].width, levels[0].height);
+    return trilinear(size, levels.size(), width, [this, &uv](const size_t& l) {
+        return bilinear(levels[l], uv);
+    });
+}
+
+void Image::sample(
+    const float* px,
+    const float* py,
+    const float* pz,
+    const TexCoord* uvs,
+    const float* widths,
+    const size_t& n,
+    Vec3f* out
+) const {
+    // the lookups are mapped by the texture
+    // coordinates and not by the points
+    for (size_t i = 0; i < n; i++) {
+        out[i] = Image::sample(Vec3f(px[i], py[i], pz[i]), uvs[i], widths[i]);
+    }
+}
+
+
+/*
+ *  Tiled Image Texture
+ */
+
+TiledImage::TiledImage(
+    TileCache& cache,
+    const char* fpath
+) {
+    int32_t file = cache.open(fpath);
+    if (file < 0) { return; }
+    // the header fills the first block, note that the
+    // block has to be copied before the next lookup
+    TiledImageHeader header;
+    memcpy(&header, cache.block(file, 0), sizeof(TiledImageHeader));
+    if (!std::equal(tiled_magic, tiled_magic + 8, header.magic)
+        || (header.version != tiled_version)
+        || (header.n_levels == 0) || (header.n_levels > max_tiled_levels)) {
+        return;
+    }
+    this->cache = &cache;
+    this->file = file;
+    levels.assign(header.levels, header.levels + header.n_levels);
+    // the last level holds the average
+    uint32_t t = texel(levels.back(), 0, 0);
+    average = Vec3f(decode(t, 0), decode(t, 1), decode(t, 2));
+}
+
+inline uint32_t TiledImage::texel(
+    const TiledLevel& level,
+    const size_t& x,
+    const size_t& y
+) const {
+    // find the block, the tile within the
+    // block and the texel within the tile
+    size_t bx = x / (4 * block_tiles), by = y / (4 * block_tiles);
+    const ImageTile* tiles = (const ImageTile*)cache->block(file, level.first_block + by * level.n_blocks_x + bx);
+    const ImageTile& tile = tiles[((y >> 2) % block_tiles) * block_tiles + (x >> 2) % block_tiles];
+    return tile.texels[((y & 3) << 2) | (x & 3)];
+}
+
+size_t TiledImage::width(void) const { return levels.empty()? 0 : levels[0].width; }
+size_t TiledImage::height(void) const { return levels.empty()? 0 : levels[0].height; }
+size_t TiledImage::n_levels(void) const { return levels.size(); }
+
+Vec3f TiledImage::bilinear(
+    const TiledLevel& level,
+    const TexCoord& uv
+) const {
+    BilinearTexels b = bilinear_texels(level.width, level.height, uv);
+    // most of the time all four texels are in the
+    // same block which is then looked up only once
+    size_t block_size = 4 * block_tiles;
+    if ((b.x0 / block_size == b.x1 / block_size) && (b.y0 / block_size == b.y1 / block_size)) {
+        const ImageTile* tiles = (const ImageTile*)cache->block(file, level.first_block + (b.y0 / block_size) * level.n_blocks_x + b.x0 / block_size);
+        auto in_block = [tiles](const size_t& x, const size_t& y) {
+            const ImageTile& tile = tiles[((y >> 2) % block_tiles) * block_tiles + (x >> 2) % block_tiles];
+            return tile.texels[((y & 3) << 2) | (x & 3)];
+        };
+        uint32_t t[4] = { in_block(b.x0, b.y0), in_block(b.x1, b.y0), in_block(b.x0, b.y1), in_block(b.x1, b.y1) };
+        return bilinear_blend(t, b.tx, b.ty);
+    }
+    uint32_t t[4] = {
+        texel(level, b.x0, b.y0), texel(level, b.x1, b.y0),
+        texel(level, b.x0, b.y1), texel(level, b.x1, b.y1)
+    };
+    return bilinear_blend(t, b.tx, b.ty);
+}
+
+Vec3f TiledImage::color(const Vec3f& p) const {
+    return average;
+}
+
+Vec3f TiledImage::sample(
+    const Vec3f& p,
+    const TexCoord& uv,
+    const float& width
+) const {
+    if (levels.empty()) { return Vec3f::zeros; }
+    size_t size = std::max(levels[0].width, levels[0].height);
+    return trilinear(size, levels.size(), width, [this, &uv](const size_t& l) {
+        return bilinear(levels[l], uv);
+    });
+}
+
+void TiledImage::sample(
+    const float* px,
+    const float* py,
+    const float* pz,
+    const TexCoord* uvs,
+    const float* widths,
+    const size_t& n,
+    Vec3f* out
+) const {
+    // the lookups are mapped by the texture
+    // coordinates and not by the points
+    for (size_t i = 0; i < n; i++) {
+        out[i] = TiledImage::sample(Vec3f(px[i], py[i], pz[i]), uvs[i], widths[i]);
+    }
+}
@@ -2,20 +2,57 @@
 #define H_TEXTURE
 
 // includes
+#include <vector>
+#include <cstdint>
+#include <cstddef>
 #include "./vec.hpp"
+#include "./tilecache.hpp"
 
 namespace txr {
 
+// texture coordinates of a point on a surface
+typedef struct TexCoord {
+    float u, v;
+} TexCoord;
+
 class Texture {
 public:
-    // abstract function to get the 
+    // abstract function to get the
     // color value of the texture at
     // a specific point in space
     virtual Vec3f color(const Vec3f& p) const = 0;
+    // get the color value at a surface point given its
+    // texture coordinates and the width of the ray
+    // footprint in texture space, textures that are
+    // not mapped by texture coordinates use the point
+    virtual Vec3f sample(
+        const Vec3f& p,
+        const TexCoord& uv,
+        const float& width
+    ) const;
+    // batched versions of the above evaluating n points
+    // given by their coordinates at once, the default
+    // implementations call the single point versions
+    virtual void color(
+        const float* px,
+        const float* py,
+        const float* pz,
+        const size_t& n,
+        Vec3f* out
+    ) const;
+    virtual void sample(
+        const float* px,
+        const float* py,
+        const float* pz,
+        const TexCoord* uvs,
+        const float* widths,
+        const size_t& n,
+        Vec3f* out
+    ) const;
 };
 
-// Texture with constant color 
-// value at any point 
+// Texture with constant color
+// value at any point
 class Constant : public Texture {
 private:
     // the color value of
@@ -25,11 +62,242 @@ public:
     // constructor
     Constant(const Vec3f& color);
     // get the constant color value
+    using Texture::color;
     virtual Vec3f color(const Vec3f& p) const;
+    virtual void color(
+        const float* px,
+        const float* py,
+        const float* pz,
+        const size_t& n,
+        Vec3f* out
+    ) const;
 };
 
+// procedural textures evaluating eight points at a time,
+// a single point is evaluated as a batch of one point
+
+// checkerboard of cubes with the given edge length
+// alternating between two colors
+class Checker : public Texture {
+private:
+    Vec3f a, b;
+    float inv_size;
+public:
+    // constructor
+    Checker(
+        const Vec3f& a,
+        const Vec3f& b,
+        const float& size
+    );
+    using Texture::color;
+    virtual Vec3f color(const Vec3f& p) const;
+    virtual void color(
+        const float* px,
+        const float* py,
+        const float* pz,
+        const size_t& n,
+        Vec3f* out
+    ) const;
 };
 
-#endif // H_TEXTURE
+// perlin gradient noise blending between two colors,
+// the frequency is the number of lattice cells per
+// unit length and each further octave doubles the
+// frequency and halves the amplitude
+class Noise : public Texture {
+private:
+    Vec3f a, b;
+    float frequency;
+    size_t octaves;
+public:
+    // constructor
+    Noise(
+        const Vec3f& a,
+        const Vec3f& b,
+        const float& frequency,
+        const size_t& octaves = 1
+    );
+    using Texture::color;
+    virtual Vec3f color(const Vec3f& p) const;
+    virtual void color(
+        const float* px,
+        const float* py,
+        const float* pz,
+        const size_t& n,
+        Vec3f* out
+    ) const;
+};
 
+// linear blend between two colors along the line from
+// the start point to the end point, the colors are
+// clamped before the start and after the end
+class Gradient : public Texture {
+private:
+    Vec3f a, b;
+    Vec3f start;
+    // the direction scaled by its inverse squared
+    // length such that the dot product with a
+    // point gives the blend weight
+    Vec3f dir;
+public:
+    // constructor
+    Gradient(
+        const Vec3f& a,
+        const Vec3f& b,
+        const Vec3f& start,
+        const Vec3f& end
+    );
+    using Texture::color;
+    virtual Vec3f color(const Vec3f& p) const;
+    virtual void color(
+        const float* px,
+        const float* py,
+        const float* pz,
+        const size_t& n,
+        Vec3f* out
+    ) const;
+};
 
+// block of 4x4 texels filling exactly one cache line,
+// each texel holds 8-bit rgba values in display gamma
+typedef struct alignas(64) ImageTile {
+    uint32_t texels[16];
+} ImageTile;
+
+// single level of a mip pyramid
+// stored in tiles row by row
+typedef struct MipLevel {
+    size_t width, height;
+    size_t n_tiles_x;
+    std::vector<ImageTile> tiles;
+} MipLevel;
+
+// image texture mapped by texture coordinates which repeat
+// outside of the unit square, the footprint of the ray picks
+// the levels of the mip pyramid that are filtered trilinearly
+class Image : public Texture {
+private:
+    // the levels of the mip pyramid starting
+    // with the full resolution image
+    std::vector<MipLevel> levels;
+    // get the packed texel at the given position
+    inline uint32_t texel(
+        const MipLevel& level,
+        const size_t& x,
+        const size_t& y
+    ) const;
+    // bilinear lookup in the given level
+    Vec3f bilinear(
+        const MipLevel& level,
+        const TexCoord& uv
+    ) const;
+public:
+    // constructors, the image is given by its 8-bit rgb
+    // values in display gamma row by row from the top
+    Image(void) = default;
+    Image(
+        const size_t& width,
+        const size_t& height,
+        const uint8_t* rgb
+    );
+    // load an uncompressed 24 or 32 bit bmp file,
+    // the image is empty if the file is invalid
+    static Image load_bmp(const char* fpath);
+    // write the mip pyramid to a file that is read
+    // block by block through a tile cache
+    bool save_tiled(const char* fpath) const;
+    // getters
+    size_t width(void) const;
+    size_t height(void) const;
+    size_t n_levels(void) const;
+    // the average color of the image
+    using Texture::color;
+    virtual Vec3f color(const Vec3f& p) const;
+    // trilinear lookup at the given texture coordinates
+    using Texture::sample;
+    virtual Vec3f sample(
+        const Vec3f& p,
+        const TexCoord& uv,
+        const float& width
+    ) const;
+    virtual void sample(
+        const float* px,
+        const float* py,
+        const float* pz,
+        const TexCoord* uvs,
+        const float* widths,
+        const size_t& n,
+        Vec3f* out
+    ) const;
+};
+
+// level of a tiled image file, the level is split
+// into blocks of 8x8 tiles stored row by row, each
+// filling a single block of the tile cache
+typedef struct TiledLevel {
+    uint64_t width, height;
+    uint64_t n_blocks_x;
+    uint64_t first_block;
+} TiledLevel;
+
+// image texture like the image above whose mip pyramid is
+// stored in a file, the blocks of the file are loaded into
+// a tile cache the first time they are used and might be
+// evicted again, thus the images may exceed the memory
+class TiledImage : public Texture {
+private:
+    // the cache the blocks are read through
+    // and the index of the file in the cache
+    TileCache* cache = nullptr;
+    int32_t file = -1;
+    // the levels of the mip pyramid
+    std::vector<TiledLevel> levels;
+    // the color of the last level
+    Vec3f average = Vec3f::zeros;
+    // get the packed texel at the given position
+    inline uint32_t texel(
+        const TiledLevel& level,
+        const size_t& x,
+        const size_t& y
+    ) const;
+    // bilinear lookup in the given level
+    Vec3f bilinear(
+        const TiledLevel& level,
+        const TexCoord& uv
+    ) const;
+public:
+    // constructor, opens a file written by
+    // Image::save_tiled in the given cache, the
+    // image is empty if the file is invalid
+    TiledImage(
+        TileCache& cache,
+        const char* fpath
+    );
+    // getters
+    size_t width(void) const;
+    size_t height(void) const;
+    size_t n_levels(void) const;
+    // the average color of the image
+    using Texture::color;
+    virtual Vec3f color(const Vec3f& p) const;
+    // trilinear lookup at the given texture coordinates
+    using Texture::sample;
+    virtual Vec3f sample(
+        const Vec3f& p,
+        const TexCoord& uv,
+        const float& width
+    ) const;
+    virtual void sample(
+        const float* px,
+        const float* py,
+        const float* pz,
+        const TexCoord* uvs,
+        const float* widths,
+        const size_t& n,
+        Vec3f* out
+    ) const;
+};
+
+};
+
+#endif // H_TEXTURE
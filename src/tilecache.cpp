@@ -0,0 +1,150 @@
+#include "./tilecache.hpp"
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+// use texture namespace
+using namespace txr;
+
+// number of blocks each thread remembers
+const size_t n_local_entries = 64;
+
+// entry of the lookup table of a thread, the block
+// is kept alive by the entry even if the shared
+// cache evicts it in the meantime
+typedef struct LocalEntry {
+    uint64_t serial = 0;
+    uint64_t key = 0;
+    std::shared_ptr<CacheBlock> block;
+} LocalEntry;
+
+// source of the serial numbers of the caches
+// and of the hit counters of the threads
+static std::atomic<uint64_t> next_serial{1};
+static std::atomic<size_t> next_thread{0};
+
+// the hit counter the calling thread adds to
+inline size_t thread_counter(const size_t& n_counters) {
+    static thread_local size_t counter = next_thread++;
+    return counter % n_counters;
+}
+
+// the key of a block combines the index
+// of its file and its index in the file
+inline uint64_t block_key(const uint32_t& file, const uint64_t& index) {
+    return ((uint64_t)file << 40) | index;
+}
+
+TileCache::TileCache(const size_t& budget) :
+    serial(next_serial++),
+    capacity(std::max<size_t>(1, budget / sizeof(CacheBlock)))
+{
+    slots.reserve(capacity);
+    slot_keys.reserve(capacity);
+}
+
+TileCache::~TileCache(void) {
+    // close all files
+    for (const int& fd : fds) { close(fd); }
+}
+
+int32_t TileCache::open(const char* fpath) {
+    int fd = ::open(fpath, O_RDONLY);
+    if (fd < 0) { return -1; }
+    std::lock_guard<std::mutex> lock(mutex);
+    fds.push_back(fd);
+    return fds.size() - 1;
+}
+
+std::shared_ptr<CacheBlock> TileCache::fetch(const uint64_t& key) {
+    int fd = -1;
+    {
+        // look for the block in the shared cache
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = slot_of.find(key);
+        if (it != slot_of.end()) {
+            hit_counters[thread_counter(n_hit_counters)].n.fetch_add(1, std::memory_order_relaxed);
+            slots[it->second]->referenced.store(true, std::memory_order_relaxed);
+            return slots[it->second];
+        }
+        if ((key >> 40) < fds.size()) { fd = fds[key >> 40]; }
+    }
+    // read the block without holding the lock such that
+    // other threads are not blocked by the disk, the
+    // part of the block behind the file stays zero
+    std::shared_ptr<CacheBlock> block = std::make_shared<CacheBlock>();
+    uint64_t index = key & ((uint64_t(1) << 40) - 1);
+    ssize_t n = (fd < 0)? 0 : pread(fd, block->bytes, cache_block_size, index * cache_block_size);
+    n_misses.fetch_add(1, std::memory_order_relaxed);
+    n_bytes_read.fetch_add(std::max<ssize_t>(n, 0), std::memory_order_relaxed);
+    block->referenced.store(true, std::memory_order_relaxed);
+    // insert the block into the shared cache
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = slot_of.find(key);
+    if (it != slot_of.end()) {
+        // another thread was faster
+        return slots[it->second];
+    }
+    size_t slot;
+    if (slots.size() < capacity) {
+        // use a free slot
+        slot = slots.size();
+        slots.push_back(block);
+        slot_keys.push_back(key);
+    } else {
+        // the clock hand skips the recently used blocks
+        // and clears their flags, thus it stops at the
+        // latest after one full round
+        while (slots[hand]->referenced.load(std::memory_order_relaxed)) {
+            slots[hand]->referenced.store(false, std::memory_order_relaxed);
+            hand = (hand + 1) % capacity;
+        }
+        slot = hand;
+        hand = (hand + 1) % capacity;
+        slot_of.erase(slot_keys[slot]);
+        slots[slot] = block;
+        slot_keys[slot] = key;
+    }
+    slot_of[key] = slot;
+    return block;
+}
+
+const uint8_t* TileCache::block(
+    const uint32_t& file,
+    const uint64_t& index
+) {
+    // the lookup table of the calling thread is
+    // shared by all caches, the serial number of
+    // the cache is part of the key
+    static thread_local LocalEntry local[n_local_entries];
+    uint64_t key = block_key(file, index);
+    LocalEntry& entry = local[(key * 0x9e3779b97f4a7c15ull) >> 58];
+    if ((entry.serial == serial) && (entry.key == key)) {
+        hit_counters[thread_counter(n_hit_counters)].n.fetch_add(1, std::memory_order_relaxed);
+        // only write the flag if it is cleared to
+        // not invalidate the line in other cores
+        if (!entry.block->referenced.load(std::memory_order_relaxed)) {
+            entry.block->referenced.store(true, std::memory_order_relaxed);
+        }
+        return entry.block->bytes;
+    }
+    entry.block = fetch(key);
+    entry.serial = serial;
+    entry.key = key;
+    return entry.block->bytes;
+}
+
+size_t TileCache::budget(void) const { return capacity * sizeof(CacheBlock); }
+
+size_t TileCache::n_blocks(void) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return slots.size();
+}
+
+TileCacheStats TileCache::stats(void) const {
+    TileCacheStats s;
+    for (const HitCounter& c : hit_counters) { s.n_hits += c.n.load(std::memory_order_relaxed); }
+    s.n_misses = n_misses.load(std::memory_order_relaxed);
+    s.n_bytes_read = n_bytes_read.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,94 @@
+#ifndef H_TILECACHE
+#define H_TILECACHE
+
+// includes
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+namespace txr {
+
+// size of the blocks that are read from disk at once
+const size_t cache_block_size = 4096;
+
+// block of a cached file together with the flag
+// of the clock that marks recently used blocks
+typedef struct alignas(64) CacheBlock {
+    uint8_t bytes[cache_block_size];
+    std::atomic<bool> referenced;
+} CacheBlock;
+
+// counters of the lookups of a tile cache
+typedef struct TileCacheStats {
+    // lookups answered from memory, blocks
+    // loaded from disk and the bytes read
+    size_t n_hits = 0;
+    size_t n_misses = 0;
+    size_t n_bytes_read = 0;
+} TileCacheStats;
+
+// cache of fixed size blocks of files shared by all threads,
+// the blocks are read from disk when they are first used and
+// evicted by a clock once the memory budget is exhausted, each
+// thread keeps a small lookup table of the blocks it used last
+// such that hot blocks are found without taking the lock
+class TileCache {
+private:
+    // unique number of the cache to tell apart
+    // the entries of different caches in the
+    // lookup tables of the threads
+    uint64_t serial;
+    // maximum number of blocks held in memory
+    size_t capacity;
+    // the open files, a block is identified by the
+    // index of its file and its index in the file
+    std::vector<int> fds;
+    // the cached blocks, the key of each slot and
+    // the slot of each key, the clock hand is the
+    // next slot to consider for eviction
+    std::vector<std::shared_ptr<CacheBlock>> slots;
+    std::vector<uint64_t> slot_keys;
+    std::unordered_map<uint64_t, size_t> slot_of;
+    size_t hand = 0;
+    // lock guarding the files and the slots
+    mutable std::mutex mutex;
+    // the hits are counted in separate cache lines
+    // per thread to not share a single counter
+    typedef struct alignas(64) HitCounter {
+        std::atomic<size_t> n{0};
+    } HitCounter;
+    static constexpr size_t n_hit_counters = 16;
+    HitCounter hit_counters[n_hit_counters];
+    std::atomic<size_t> n_misses{0};
+    std::atomic<size_t> n_bytes_read{0};
+    // find the block in the shared cache
+    // or read it from disk
+    std::shared_ptr<CacheBlock> fetch(const uint64_t& key);
+public:
+    // constructor / destructor, the budget is
+    // the memory of the shared cache in bytes
+    TileCache(const size_t& budget);
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+    ~TileCache(void);
+    // open a file to read blocks from, returns
+    // the index of the file or -1 on failure
+    int32_t open(const char* fpath);
+    // get the block with the given index of an open file,
+    // the memory stays valid until the next lookup of the
+    // calling thread, blocks that cannot be read are zero
+    const uint8_t* block(const uint32_t& file, const uint64_t& index);
+    // getters
+    size_t budget(void) const;
+    size_t n_blocks(void) const;
+    // the counters summed over all threads
+    TileCacheStats stats(void) const;
+};
+
+};
+
+#endif // H_TILECACHE
@@ -8,3 +8,8 @@ const Vec4f Vec4f::eps = Vec4f(1e-4);
 const Vec4f Vec4f::neps = Vec4f(-1e-4);
 const Vec4f Vec4f::inf = Vec4f(-logf(0));
 const Vec4f Vec4f::ninf = Vec4f(logf(0));
+
+#ifdef __AVX__
+const Vec8f Vec8f::zeros = Vec8f(0.0f);
+const Vec8f Vec8f::ones = Vec8f(1.0f);
+#endif // __AVX__
@@ -2,6 +2,7 @@
 #define H_VEC3F
 
 #include <ostream>
+#include <cstdint>
 #include <immintrin.h>
 
 /*
@@ -14,6 +15,7 @@ private:
     union {
         __m128 m_value; // simd memory
         float items[4]; // easy access
+        uint32_t words[4]; // bit-level access
     };
 public:
     // constructors
@@ -32,6 +34,9 @@ public:
     // easy access helpers
     inline float& operator[](const size_t& i) { return items[i]; }
     inline const float& operator[](const size_t& i) const { return items[i]; }
+    // integers stored bitwise in the entries
+    static inline Vec4f from_bits(const uint32_t& bits) { return _mm_castsi128_ps(_mm_set1_epi32(bits)); }
+    inline const uint32_t& bits(const size_t& i) const { return words[i]; }
     // masked take
     inline Vec4f take(
         const Vec4f& other,
@@ -49,6 +54,15 @@ public:
         return _mm_hadd_ps(tmp, tmp);
     }
     inline Vec4f rotate(void) const { return _mm_shuffle_ps(*this, *this, 0x39); }
+    // horizontal minimum broadcasted to all entries
+    inline Vec4f hmin(void) const {
+        __m128 tmp = _mm_min_ps(*this, _mm_shuffle_ps(*this, *this, 0x4e));
+        return _mm_min_ps(tmp, _mm_shuffle_ps(tmp, tmp, 0xb1));
+    }
+    // strict comparisons and bit-level mask
+    inline Vec4f lt(const Vec4f& other) const { return _mm_cmplt_ps(*this, other); }
+    inline Vec4f eq(const Vec4f& other) const { return _mm_cmpeq_ps(*this, other); }
+    inline unsigned int movemask(void) const { return _mm_movemask_ps(*this); }
     // fused multiply-add operation
     inline Vec4f fmadd(
         const Vec4f& b,
@@ -70,6 +84,8 @@ public:
     inline Vec4f sq_norm(void) const { return this->dot(*this); }
     inline Vec4f norm(void) const { return this->sq_norm().sqrt(); }
     inline Vec4f normalize(void) const { return _mm_div_ps(*this, this->norm()); }
+    // number of entries
+    static constexpr size_t width = 4;
     // common vectors
     static const Vec4f zeros;
     static const Vec4f ones;
@@ -101,6 +117,81 @@ inline std::ostream& operator<<(std::ostream& os, const Vec4f& v) {
 }
 
 
+#ifdef __AVX__
+
+/*
+ *  8-dimensional SIMD Vector
+ */
+
+class Vec8f
+{
+private:
+    union {
+        __m256 m_value; // simd memory
+        float items[8]; // easy access
+        uint32_t words[8]; // bit-level access
+    };
+public:
+    // constructors
+    Vec8f(void) = default;
+    inline Vec8f(const __m256& p) : m_value(p) {}
+    inline Vec8f(const float& val) : m_value(_mm256_set1_ps(val)) {}
+    // converter and other operators
+    inline operator __m256(void) const { return m_value; }
+    inline Vec8f& operator=(const __m256& p) { m_value = p; return *this; }
+    // easy access helpers
+    inline float& operator[](const size_t& i) { return items[i]; }
+    inline const float& operator[](const size_t& i) const { return items[i]; }
+    // integers stored bitwise in the entries
+    static inline Vec8f from_bits(const uint32_t& bits) { return _mm256_castsi256_ps(_mm256_set1_epi32(bits)); }
+    inline const uint32_t& bits(const size_t& i) const { return words[i]; }
+    // masked take
+    inline Vec8f take(
+        const Vec8f& other,
+        const Vec8f& mask
+    ) const {
+        return _mm256_blendv_ps(*this, other, mask);
+    }
+    // arithmetic members
+    inline Vec8f sqrt(void) const { return _mm256_sqrt_ps(*this); }
+    inline Vec8f min(const Vec8f& other) const { return _mm256_min_ps(*this, other); }
+    inline Vec8f max(const Vec8f& other) const { return _mm256_max_ps(*this, other); }
+    // fused multiply-add operation
+    inline Vec8f fmadd(
+        const Vec8f& b,
+        const Vec8f& c
+    ) const {
+        return _mm256_fmadd_ps(*this, b, c);
+    }
+    // horizontal minimum broadcasted to all entries
+    inline Vec8f hmin(void) const {
+        __m256 tmp = _mm256_min_ps(*this, _mm256_permute2f128_ps(*this, *this, 0x01));
+        tmp = _mm256_min_ps(tmp, _mm256_shuffle_ps(tmp, tmp, 0x4e));
+        return _mm256_min_ps(tmp, _mm256_shuffle_ps(tmp, tmp, 0xb1));
+    }
+    // strict comparisons and bit-level mask
+    inline Vec8f lt(const Vec8f& other) const { return _mm256_cmp_ps(*this, other, _CMP_LT_OQ); }
+    inline Vec8f eq(const Vec8f& other) const { return _mm256_cmp_ps(*this, other, _CMP_EQ_OQ); }
+    inline unsigned int movemask(void) const { return _mm256_movemask_ps(*this); }
+    // number of entries
+    static constexpr size_t width = 8;
+    // common vectors
+    static const Vec8f zeros;
+    static const Vec8f ones;
+};
+
+// arithmetic operators
+inline Vec8f operator+(const Vec8f& a, const Vec8f& b) { return _mm256_add_ps(a, b); }
+inline Vec8f operator-(const Vec8f& a, const Vec8f& b) { return _mm256_sub_ps(a, b); }
+inline Vec8f operator*(const Vec8f& a, const Vec8f& b) { return _mm256_mul_ps(a, b); }
+inline Vec8f operator/(const Vec8f& a, const Vec8f& b) { return _mm256_div_ps(a, b); }
+inline Vec8f operator<(const Vec8f& a, const Vec8f& b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+inline Vec8f operator&(const Vec8f& a, const Vec8f& b) { return _mm256_and_ps(a, b); }
+inline Vec8f operator|(const Vec8f& a, const Vec8f& b) { return _mm256_or_ps(a, b); }
+
+#endif // __AVX__
+
+
 /*
  *  3-dimensional SIMD Vector
  */